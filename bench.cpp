@@ -0,0 +1,210 @@
+// Scaling benchmark: generates seeded workloads of 1K, 10K, ... events (up
+// to --max) and runs each engine on them, reporting events/s, peak RSS and
+// output bytes/s. Every run happens in its own child process so peak RSS is
+// per run. "Events" are trace instructions executed for the stream and
+// nested engines, and calendar events for the event engine. "parallel" is
+// the nested engine with FORK subtrees on one thread per core.
+// Usage: bench [--max EVENTS] [--engines stream,nested,parallel,event] [--seed N]
+//              [--disk] [--json PATH]
+// Logs go to /dev/null unless --disk is given. Results are also written as
+// JSON (default bench_results.json).
+#include "nested_simulator.hpp"
+#include "parallel_nested.hpp"
+#include "event_engine.hpp"
+#include "workload_gen.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+static const char* const ENGINES[] = {"stream", "nested", "parallel", "event"};
+
+// What a child reports back over its pipe
+struct run_result {
+    uint64_t events = 0;
+    uint64_t output_bytes = 0;
+    double seconds = 0;
+    long long end_time = 0;
+    int ok = 0;
+};
+
+struct bench_row {
+    uint64_t size;
+    string engine;
+    run_result result;
+    long peak_rss_kb;
+};
+
+static run_result run_engine(const string& engine, const string& dir, bool disk) {
+    string vec = dir + "/vector_table.txt", dev = dir + "/device_table.txt", ext = dir + "/external_files.txt";
+    string trace = dir + "/trace_1.txt";
+    char* argv[] = {(char*)"bench", (char*)trace.c_str(), (char*)vec.c_str(), (char*)dev.c_str(), (char*)ext.c_str()};
+    auto [vectors, delays, catalog] = parse_args(5, argv);
+    dispatch_table dispatch(vectors, delays);
+
+    simulator_context ctx;
+    PCB init(0, -1, "init", 1, -1);
+    allocate_memory(ctx, &init);
+    log_sink exec_log = log_sink::to_file(disk ? dir + "/execution.txt" : "/dev/null");
+    log_sink sys_log = log_sink::to_file(disk ? dir + "/system_status.txt" : "/dev/null");
+    program_cache cache(dir);
+
+    run_result r;
+    auto start = chrono::steady_clock::now();
+    if (engine == "stream") {
+        auto reader = line_reader::open(trace);
+        string_pool names;
+        trace_simulator sim(ctx, names, dispatch, catalog, init, 0, exec_log, sys_log);
+        r.end_time = simulate_stream(*reader, names, sim);
+        r.events = reader->line_number();
+    } else if (engine == "nested") {
+        auto program = make_shared<const compiled_program>(compile_program(trace));
+        nested_simulator sim(ctx, cache, catalog, dispatch, exec_log, sys_log);
+        r.end_time = sim.run(program, init);
+        r.events = sim.instructions();
+    } else if (engine == "parallel") {
+        auto program = make_shared<const compiled_program>(compile_program(trace));
+        thread_pool pool;
+        parallel_nested_simulator sim(ctx, cache, catalog, dispatch, exec_log, sys_log, status_mode::FULL, pool);
+        r.end_time = sim.run(program, init);
+        r.events = sim.instructions();
+    } else {
+        auto program = make_shared<const compiled_program>(compile_program(trace));
+        event_engine engine(ctx, cache, catalog, dispatch, event_config{}, exec_log, sys_log);
+        const event_engine::stats& s = engine.run(program, init);
+        r.end_time = s.end_time;
+        r.events = s.events;
+    }
+    exec_log.flush();
+    sys_log.flush();
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    r.output_bytes = exec_log.bytes() + sys_log.bytes();
+    r.ok = 1;
+    return r;
+}
+
+// Runs one engine in a child process; peak RSS comes from its rusage
+static bench_row measure(uint64_t size, const string& engine, const string& dir, bool disk) {
+    bench_row row{size, engine, {}, 0};
+    int fds[2];
+    if (pipe(fds) != 0) { perror("pipe"); return row; }
+    pid_t child = fork();
+    if (child < 0) { perror("fork"); close(fds[0]); close(fds[1]); return row; }
+    if (child == 0) {
+        close(fds[0]);
+        run_result r;
+        try {
+            r = run_engine(engine, dir, disk);
+        } catch (const exception& e) {
+            cerr << engine << ": " << e.what() << endl;
+        }
+        ssize_t n = write(fds[1], &r, sizeof r);
+        _exit(n == (ssize_t)sizeof r ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t n = read(fds[0], &row.result, sizeof row.result);
+    close(fds[0]);
+    int status = 0;
+    rusage usage{};
+    wait4(child, &status, 0, &usage);
+    if (n != (ssize_t)sizeof row.result || !WIFEXITED(status) || WEXITSTATUS(status) != 0) row.result.ok = 0;
+    row.peak_rss_kb = usage.ru_maxrss;
+    return row;
+}
+
+static void write_json(const string& path, const workload_spec& spec, const vector<bench_row>& rows) {
+    ofstream out(path);
+    if (!out) throw runtime_error("cannot open " + path + " for writing");
+    out << "{\n  \"seed\": " << spec.seed << ",\n  \"fork_rate\": " << spec.fork_rate
+        << ",\n  \"fork_depth\": " << spec.fork_depth << ",\n  \"syscall_mix\": " << spec.syscall_mix
+        << ",\n  \"runs\": [\n";
+    for (size_t i = 0; i < rows.size(); i++) {
+        const bench_row& row = rows[i];
+        const run_result& r = row.result;
+        double secs = r.seconds > 0 ? r.seconds : 1e-9;
+        out << "    {\"size\": " << row.size << ", \"engine\": \"" << row.engine << "\", \"ok\": "
+            << (r.ok ? "true" : "false") << ", \"events\": " << r.events << ", \"seconds\": " << r.seconds
+            << ", \"events_per_sec\": " << (uint64_t)(r.events / secs) << ", \"peak_rss_kb\": " << row.peak_rss_kb
+            << ", \"output_bytes\": " << r.output_bytes << ", \"output_bytes_per_sec\": "
+            << (uint64_t)(r.output_bytes / secs) << ", \"end_time\": " << r.end_time << "}"
+            << (i + 1 < rows.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+    if (!out) throw runtime_error("failed writing " + path);
+}
+
+int main(int argc, char** argv) {
+    uint64_t max_events = 1000000;
+    vector<string> engines(begin(ENGINES), end(ENGINES));
+    string json_path = "bench_results.json";
+    bool disk = false;
+    workload_spec spec;
+    // Programs stay within the smallest partition, so EXEC never runs out of memory
+    spec.max_size = 2;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--max" && i + 1 < argc) max_events = stoull(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) spec.seed = stoull(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc) json_path = argv[++i];
+        else if (arg == "--disk") disk = true;
+        else if (arg == "--engines" && i + 1 < argc) {
+            engines.clear();
+            string list = argv[++i];
+            for (size_t at = 0; at <= list.size();) {
+                size_t comma = min(list.find(',', at), list.size());
+                string name = list.substr(at, comma - at);
+                if (find(begin(ENGINES), end(ENGINES), name) == end(ENGINES)) {
+                    cerr << "Unknown engine: " << name << " (stream, nested, parallel, event)\n";
+                    return 1;
+                }
+                engines.push_back(name);
+                at = comma + 1;
+            }
+        } else {
+            cerr << "usage: bench [--max EVENTS] [--engines stream,nested,parallel,event] [--seed N] [--disk] [--json PATH]\n";
+            return 1;
+        }
+    }
+
+    char tmp[] = "/tmp/bench_XXXXXX";
+    if (!mkdtemp(tmp)) { perror("mkdtemp"); return 1; }
+    string dir = tmp;
+
+    cout << setw(11) << "size" << setw(10) << "engine" << setw(12) << "events" << setw(14) << "events/s"
+         << setw(12) << "peak RSS" << setw(14) << "out MB/s" << "\n";
+    vector<bench_row> rows;
+    for (uint64_t size = 1000; size <= max_events; size *= 10) {
+        spec.lines = size;
+        generate_workload(spec, dir);
+        for (const string& engine : engines) {
+            bench_row row = measure(size, engine, dir, disk);
+            const run_result& r = row.result;
+            double secs = r.seconds > 0 ? r.seconds : 1e-9;
+            cout << setw(11) << size << setw(10) << engine;
+            if (!r.ok) cout << "  failed\n";
+            else cout << setw(12) << r.events << setw(14) << (uint64_t)(r.events / secs)
+                      << setw(9) << row.peak_rss_kb / 1024 << " MB" << setw(14) << fixed << setprecision(1)
+                      << r.output_bytes / secs / 1e6 << "\n";
+            rows.push_back(row);
+        }
+    }
+    fs::remove_all(dir);
+
+    try {
+        write_json(json_path, spec, rows);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    cout << "results: " << json_path << "\n";
+    return 0;
+}
@@ -0,0 +1,48 @@
+// Cost of the program-size lookup done on every EXEC, as the external files
+// table grows: the old by-value linear get_size against program_catalog.
+// Usage: bench_catalog [max_programs] [seed]
+#include "interrupts_101297993_101302793.hpp"
+#include <chrono>
+
+using namespace std;
+
+template <typename F>
+static double ns_per_call(size_t calls, F&& f) {
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < calls; i++) f(i);
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / calls;
+}
+
+int main(int argc, char** argv) {
+    size_t max_programs = argc > 1 ? stoull(argv[1]) : 100000;
+    unsigned seed = argc > 2 ? (unsigned)stoul(argv[2]) : 1;
+
+    cout << setw(10) << "programs" << setw(18) << "linear ns/EXEC" << setw(18) << "catalog ns/EXEC"
+         << setw(10) << "speedup" << "\n";
+    cout << fixed << setprecision(1);
+
+    for (size_t n = 10; n <= max_programs; n *= 10) {
+        vector<external_file> files;
+        for (size_t i = 0; i < n; i++) files.push_back({"program" + to_string(i), (unsigned)(i % 40 + 1)});
+        program_catalog catalog(files);
+
+        // Same lookup sequence for both, including a few misses
+        mt19937 rng(seed);
+        vector<string> lookups(4096);
+        for (auto& name : lookups) name = "program" + to_string(rng() % (n + n / 10 + 1));
+
+        // The linear path copies the whole table per call, so scale its calls down
+        size_t linear_calls = max<size_t>(20, 2000000 / n);
+        unsigned long long sink = 0;
+        double linear = ns_per_call(linear_calls, [&](size_t i) {
+            sink += get_size(lookups[i % lookups.size()], files);
+        });
+        double hashed = ns_per_call(2000000, [&](size_t i) {
+            sink += get_size(string_view(lookups[i % lookups.size()]), catalog);
+        });
+
+        cout << setw(10) << n << setw(18) << linear << setw(18) << hashed
+             << setw(9) << linear / hashed << "x" << (sink == 42 ? " " : "") << "\n";
+    }
+    return 0;
+}
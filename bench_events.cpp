@@ -0,0 +1,61 @@
+// Event throughput of the discrete-event engine under each scheduler. The
+// workload is a fork tree: `levels` FORKs, so 2^levels processes end up
+// running the same body of CPU bursts and SYSCALLs concurrently.
+// Usage: bench_events [levels] [body_lines] [seed]
+#include "event_engine.hpp"
+#include <chrono>
+#include <unistd.h>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    unsigned levels = argc > 1 ? (unsigned)stoul(argv[1]) : 17;
+    size_t body = argc > 2 ? stoull(argv[2]) : 8;
+    unsigned seed = argc > 3 ? (unsigned)stoul(argv[3]) : 1;
+
+    char dir[] = "/tmp/bench_events_XXXXXX";
+    if (!mkdtemp(dir)) { perror("mkdtemp"); return 1; }
+    string trace_path = string(dir) + "/trace.txt";
+    {
+        mt19937 rng(seed);
+        ofstream out(trace_path);
+        for (unsigned i = 0; i < levels; i++) out << "FORK, " << 1 + rng() % 10 << "\n";
+        for (size_t i = 0; i < body; i++)
+            out << (i % 2 ? "SYSCALL, " + to_string(rng() % 20) : "CPU, " + to_string(10 + rng() % 200)) << "\n";
+    }
+    auto program = make_shared<const compiled_program>(compile_program(trace_path));
+    unlink(trace_path.c_str());
+    rmdir(dir);
+
+    vector<string> vectors(20, "0X0000");
+    vector<int> delays;
+    for (int i = 0; i < 20; i++) delays.push_back(50 + i * 25);
+    dispatch_table dispatch(vectors, delays);
+    program_catalog catalog(vector<external_file>{});
+    program_cache cache(dir);
+    // One partition per process so memory never limits the tree
+    vector<unsigned> sizes(((size_t)1 << levels) + 1, 1);
+
+    cout << "processes: " << (1ull << levels) << ", body lines: " << body << "\n";
+    cout << setw(10) << "scheduler" << setw(12) << "events" << setw(14) << "events/s"
+         << setw(14) << "end time" << setw(12) << "max live" << setw(13) << "preemptions" << "\n";
+
+    for (scheduler_kind kind : {scheduler_kind::FCFS, scheduler_kind::ROUND_ROBIN, scheduler_kind::PRIORITY}) {
+        simulator_context ctx(sizes, placement_policy::FIRST_FIT);
+        PCB init(0, -1, "init", 1, -1);
+        allocate_memory(ctx, &init);
+        log_sink exec_log = log_sink::discard(), sys_log = log_sink::discard();
+        event_config config;
+        config.scheduler = kind;
+        event_engine engine(ctx, cache, catalog, dispatch, config, exec_log, sys_log);
+
+        auto start = chrono::steady_clock::now();
+        event_engine::stats s = engine.run(program, init);
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        cout << setw(10) << scheduler_name(kind) << setw(12) << s.events
+             << setw(14) << (unsigned long long)(s.events / secs) << setw(14) << s.end_time
+             << setw(12) << s.max_live << setw(13) << s.preemptions << "\n";
+    }
+    return 0;
+}
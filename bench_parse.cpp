@@ -0,0 +1,147 @@
+// Trace parsing throughput: the per-line parsers against the delimiter scan
+// and the block parser at each SIMD level, on a generated trace held in
+// memory. Every parser must produce the same instructions.
+// Usage: bench_parse [megabytes] [seed]
+#include "interrupts_101297993_101302793.hpp"
+#include "text_scan.hpp"
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+// Same mix as bench_trace, with the spacing the assignment's traces use
+static string generate_text(size_t bytes, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> pick(0, 99), burst(1, 200), device(0, 19);
+    string out;
+    out.reserve(bytes + 64);
+    while (out.size() < bytes) {
+        int r = pick(rng);
+        if (r < 40) out += "CPU, " + to_string(burst(rng));
+        else if (r < 60) out += "SYSCALL, " + to_string(device(rng));
+        else if (r < 80) out += "END_IO, " + to_string(device(rng));
+        else if (r < 87) out += "IF_CHILD, 0";
+        else if (r < 94) out += "IF_PARENT, 0";
+        else if (r < 98) out += "ENDIF, 0";
+        else if (r < 99) out += "FORK, " + to_string(10 + pick(rng) % 5);
+        else out += "EXEC program" + to_string(3 + pick(rng) % 3) + "_1, " + to_string(60 + pick(rng) % 20);
+        out += '\n';
+    }
+    return out;
+}
+
+static double seconds_since(bench_clock::time_point start) {
+    return chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// What a parser produced, in a form that compares across name pools
+static size_t fingerprint(size_t h, const compiled_trace& trace, const string_pool& names) {
+    for (const instruction& ins : trace.code) {
+        h = h * 31 + (size_t)ins.op;
+        h = h * 31 + (size_t)(uint32_t)ins.value;
+        if (ins.op == opcode::EXEC) h = h * 31 + hash<string>{}(names.name(ins.image));
+    }
+    return h;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? stoull(argv[1]) : 256;
+    unsigned seed = argc > 2 ? (unsigned)stoul(argv[2]) : 1;
+
+    string text = generate_text(megabytes << 20, seed);
+    size_t lines = count_newlines(text);
+    cout << "generated " << text.size() / 1e6 << " MB, " << lines << " lines (seed " << seed << ")\n";
+
+    size_t expected = 0;
+    bool mismatch = false;
+    cout << fixed << setprecision(1);
+    auto report = [&](const char* name, double secs, size_t print) {
+        cout << left << setw(22) << name << right << setw(9) << text.size() / secs / 1e6 << " MB/s"
+             << setw(10) << lines / secs / 1e6 << " M lines/s\n";
+        if (expected == 0) expected = print;
+        else if (print != expected) {
+            cerr << "ERROR: " << name << " produced different instructions\n";
+            mismatch = true;
+        }
+    };
+
+    // Legacy string parser: split_delim + stoi on a copy of every line
+    {
+        auto start = bench_clock::now();
+        size_t h = 0;
+        for (size_t pos = 0; pos < text.size();) {
+            size_t nl = text.find('\n', pos);
+            auto [activity, value, extra] = parse_trace(text.substr(pos, nl - pos));
+            h += activity.size() + (size_t)value;
+            pos = nl + 1;
+        }
+        double secs = seconds_since(start);
+        cout << left << setw(22) << "parse_trace" << right << setw(9) << text.size() / secs / 1e6 << " MB/s"
+             << setw(10) << lines / secs / 1e6 << " M lines/s   (checksum " << h % 1000 << ")\n";
+    }
+
+    // Both compilers hand over instructions a block at a time, as
+    // simulate_stream does, so the output never grows past one block
+    auto run_blocks = [&](auto compile) {
+        string_pool names;
+        compiled_trace out;
+        size_t h = 0, first = 1;
+        for (size_t pos = 0; pos < text.size();) {
+            size_t cut = min(text.size(), pos + line_reader::BLOCK_SIZE);
+            if (cut < text.size()) cut = text.rfind('\n', cut - 1) + 1;
+            first += compile(string_view(text).substr(pos, cut - pos), first, names, out);
+            h = fingerprint(h, out, names);
+            out.code.clear();
+            out.literals.clear();
+            pos = cut;
+        }
+        return h;
+    };
+
+    // Per-line compiler, fed by memchr like the mapped reader's next()
+    {
+        auto start = bench_clock::now();
+        size_t h = run_blocks([](string_view block, size_t, string_pool& names, compiled_trace& out) {
+            const char* p = block.data();
+            const char* end = p + block.size();
+            size_t n = 0;
+            for (; p < end; n++) {
+                const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+                string_view line(p, nl - p);
+                if (!line.empty()) out.code.push_back(compile_line(line, names, out.literals));
+                p = nl + 1;
+            }
+            return n;
+        });
+        report("compile_line", seconds_since(start), h);
+    }
+
+    // The SIMD stage alone: delimiter masks and positions, 1 MB at a time
+    for (simd_level level : {simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2}) {
+        if (simd_select(level) != level) continue;
+        delimiter_index index;
+        size_t found = 0;
+        auto start = bench_clock::now();
+        for (size_t pos = 0; pos < text.size(); pos += line_reader::BLOCK_SIZE) {
+            index.scan(string_view(text).substr(pos, line_reader::BLOCK_SIZE));
+            found += index.structural_count();
+        }
+        double secs = seconds_since(start);
+        string name = string("delimiter_index/") + simd_level_name(level);
+        cout << left << setw(22) << name << right << setw(9) << text.size() / secs / 1e6 << " MB/s"
+             << setw(10) << found / secs / 1e6 << " M delimiters/s\n";
+    }
+
+    // Block parser at each level this CPU has
+    for (simd_level level : {simd_level::SCALAR, simd_level::SSE2, simd_level::AVX2}) {
+        if (simd_select(level) != level) continue;
+        auto start = bench_clock::now();
+        size_t h = run_blocks([](string_view block, size_t first, string_pool& names, compiled_trace& out) {
+            return compile_block(block, first, names, out);
+        });
+        string name = string("compile_block/") + simd_level_name(level);
+        report(name.c_str(), seconds_since(start), h);
+    }
+    return mismatch ? 1 : 0;
+}
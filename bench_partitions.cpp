@@ -0,0 +1,90 @@
+// Allocation throughput and internal fragmentation for each placement policy
+// on a synthetic FORK/EXEC workload.
+// Usage: bench_partitions [partitions] [operations] [seed]
+#include "partition_manager.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+struct bench_result {
+    double seconds = 0;
+    size_t allocations = 0, failures = 0;
+    double fragmentation = 0;   // mean unused fraction of allocated partitions
+    size_t peak_used = 0;
+};
+
+// FORK copies a live process's size, EXEC swaps a process's image for a new
+// size, EXIT frees one. The op stream is the same for every policy.
+static bench_result run(placement_policy policy, const vector<unsigned>& sizes, size_t ops, unsigned seed) {
+    partition_manager partitions(sizes, policy);
+    mt19937 rng(seed);
+    uniform_int_distribution<int> pick_op(0, 99);
+    // Program sizes skew small, like the assignment's tables
+    uniform_int_distribution<unsigned> small(1, 16), large(17, 64);
+
+    struct process { int partition; unsigned size; };
+    vector<process> live;
+    bench_result r;
+    double wasted = 0;
+
+    auto place = [&](unsigned size) {
+        int pn = partitions.allocate(size, 0);
+        if (pn < 0) { r.failures++; return; }
+        r.allocations++;
+        wasted += (double)(partitions.size_of(pn) - size) / max(1u, partitions.size_of(pn));
+        live.push_back({pn, size});
+        r.peak_used = max(r.peak_used, partitions.used());
+    };
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < ops; i++) {
+        int op = pick_op(rng);
+        unsigned fresh = op % 4 == 0 ? large(rng) : small(rng);
+        if (live.empty() || op < 30) {                       // FORK
+            place(live.empty() ? fresh : live[rng() % live.size()].size);
+        } else if (op < 70) {                                // EXEC
+            size_t k = rng() % live.size();
+            partitions.release(live[k].partition);
+            live[k] = live.back();
+            live.pop_back();
+            place(fresh);
+        } else {                                             // EXIT
+            size_t k = rng() % live.size();
+            partitions.release(live[k].partition);
+            live[k] = live.back();
+            live.pop_back();
+        }
+    }
+    r.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    r.fragmentation = r.allocations ? wasted / r.allocations : 0;
+    return r;
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? stoull(argv[1]) : 4096;
+    size_t ops = argc > 2 ? stoull(argv[2]) : 2000000;
+    unsigned seed = argc > 3 ? (unsigned)stoul(argv[3]) : 1;
+
+    mt19937 rng(seed);
+    uniform_int_distribution<unsigned> partition_size(1, 64);
+    vector<unsigned> sizes(count);
+    for (auto& s : sizes) s = partition_size(rng);
+
+    cout << count << " partitions, " << ops << " operations (seed " << seed << ")\n\n";
+    cout << left << setw(8) << "policy" << right << setw(14) << "allocs/s" << setw(12) << "allocs"
+         << setw(12) << "failed" << setw(12) << "int. frag" << setw(12) << "peak used" << "\n";
+    cout << fixed;
+    for (placement_policy policy : {placement_policy::LEGACY, placement_policy::FIRST_FIT,
+                                    placement_policy::BEST_FIT, placement_policy::WORST_FIT}) {
+        bench_result r = run(policy, sizes, ops, seed);
+        cout << left << setw(8) << policy_name(policy) << right
+             << setw(14) << setprecision(0) << (r.seconds > 0 ? r.allocations / r.seconds : 0.0)
+             << setw(12) << r.allocations << setw(12) << r.failures
+             << setw(11) << setprecision(1) << r.fragmentation * 100 << "%"
+             << setw(12) << r.peak_used << "\n";
+    }
+    return 0;
+}
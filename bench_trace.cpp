@@ -0,0 +1,91 @@
+// Compares the string-parsing simulate_trace path with the compiled path
+// on a generated trace. Usage: bench_trace [lines] [seed]
+#include "interrupts_101297993_101302793.hpp"
+#include <chrono>
+#include <functional>
+
+using namespace std;
+using bench_clock = chrono::steady_clock;
+
+static vector<string> generate_trace(size_t lines, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_int_distribution<int> pick(0, 99), burst(1, 200), device(0, 19);
+    vector<string> out;
+    out.reserve(lines);
+    while (out.size() < lines) {
+        int r = pick(rng);
+        if (r < 40) out.push_back("CPU, " + to_string(burst(rng)));
+        else if (r < 60) out.push_back("SYSCALL, " + to_string(device(rng)));
+        else if (r < 80) out.push_back("END_IO, " + to_string(device(rng)));
+        else if (r < 87) out.push_back("IF_CHILD, 0");
+        else if (r < 94) out.push_back("IF_PARENT, 0");
+        else if (r < 98) out.push_back("ENDIF, 0");
+        else if (r < 99) out.push_back("FORK, " + to_string(10 + pick(rng) % 5));
+        else out.push_back("EXEC program" + to_string(3 + pick(rng) % 3) + "_1, " + to_string(60 + pick(rng) % 20));
+    }
+    return out;
+}
+
+static double seconds_since(bench_clock::time_point start) {
+    return chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    size_t lines = argc > 1 ? stoull(argv[1]) : 10000000;
+    unsigned seed = argc > 2 ? (unsigned)stoul(argv[2]) : 1;
+
+    vector<string> vectors;
+    for (int i = 0; i < 26; i++) vectors.push_back("0X0" + to_string(100 + i));
+    vector<int> delays(20, 100);
+    // Sizes fit the smallest partition so EXEC never leaves a process without one
+    program_catalog catalog({{"program3", 1}, {"program4", 2}, {"program5", 2}});
+
+    cout << "generating " << lines << " trace lines (seed " << seed << ")\n";
+    vector<string> trace = generate_trace(lines, seed);
+
+    // String path: parse_trace on every line inside simulate_trace
+    simulator_context string_ctx;
+    PCB init(0, -1, "init", 1, -1);
+    allocate_memory(string_ctx, &init);
+    auto start = bench_clock::now();
+    size_t string_hash, string_bytes;
+    int string_end;
+    {
+        auto [exec_log, sys_log, t] = simulate_trace(string_ctx, trace, 0, vectors, delays, catalog, init);
+        string_hash = hash<string>{}(exec_log) ^ hash<string>{}(sys_log);
+        string_bytes = exec_log.size() + sys_log.size();
+        string_end = t;
+    }
+    double string_secs = seconds_since(start);
+
+    // Compiled path: compile once, then switch over the instruction vector
+    simulator_context compiled_ctx;
+    init = PCB(0, -1, "init", 1, -1);
+    allocate_memory(compiled_ctx, &init);
+    start = bench_clock::now();
+    string_pool names;
+    compiled_trace compiled = compile_trace(trace, names);
+    double compile_secs = seconds_since(start);
+    size_t compiled_hash;
+    int compiled_end;
+    {
+        auto [exec_log, sys_log, t] = simulate_compiled(compiled_ctx, compiled, names, 0, vectors, delays, catalog, init);
+        compiled_hash = hash<string>{}(exec_log) ^ hash<string>{}(sys_log);
+        compiled_end = t;
+    }
+    double compiled_secs = seconds_since(start);
+
+    auto rate = [&](double secs) { return secs > 0 ? lines / secs / 1e6 : 0.0; };
+    cout << fixed << setprecision(3);
+    cout << "string path:   " << string_secs << " s (" << rate(string_secs) << " M lines/s)\n";
+    cout << "compiled path: " << compiled_secs << " s (" << rate(compiled_secs) << " M lines/s), of which compile "
+         << compile_secs << " s\n";
+    cout << "speedup:       " << (compiled_secs > 0 ? string_secs / compiled_secs : 0.0) << "x\n";
+    cout << "output:        " << string_bytes << " bytes, end time " << string_end << "\n";
+
+    if (string_hash != compiled_hash || string_end != compiled_end) {
+        cerr << "ERROR: compiled path output differs from string path\n";
+        return 1;
+    }
+    return 0;
+}
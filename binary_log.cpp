@@ -0,0 +1,509 @@
+#include "binary_log.hpp"
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+enum record_tag : uint8_t {
+    LITERAL,
+    EVENT_SPACED,   // "t, d, text"
+    EVENT_TIGHT,    // "t,d,text"
+    HEADER,
+    ROW_RIGHT,      // PID right-aligned
+    ROW_LEFT,       // PID left-aligned (the legacy table's sticky std::left)
+    PAIR,
+    LINE
+};
+
+// ===== TEXT HELPERS =====
+
+// Only canonical integers ("12", "-3"; not "+3", "007" or "-0") so the
+// rendered form matches the input
+static bool parse_number(string_view s, long long& v) {
+    auto res = from_chars(s.data(), s.data() + s.size(), v);
+    if (res.ec != errc() || res.ptr != s.data() + s.size()) return false;
+    char tmp[24];
+    auto out = to_chars(tmp, tmp + sizeof tmp, v);
+    return string_view(tmp, out.ptr - tmp) == s;
+}
+
+static void append_int(string& out, long long v) {
+    char tmp[24];
+    auto res = to_chars(tmp, tmp + sizeof tmp, v);
+    out.append(tmp, res.ptr - tmp);
+}
+
+static void append_padded(string& out, string_view s, int width, bool left_align) {
+    int fill = width - (int)s.size();
+    if (!left_align && fill > 0) out.append(fill, ' ');
+    out.append(s);
+    if (left_align && fill > 0) out.append(fill, ' ');
+}
+
+static void append_padded_int(string& out, long long v, int width, bool left_align) {
+    char tmp[24];
+    auto res = to_chars(tmp, tmp + sizeof tmp, v);
+    append_padded(out, string_view(tmp, res.ptr - tmp), width, left_align);
+}
+
+// Same layout as write_snapshot / pcb_table::write_table
+static void render_row(string& out, bool pid_left, long long pid, string_view name,
+                       long long partition, long long size, string_view state) {
+    out.append("| "); append_padded_int(out, pid, 3, pid_left);
+    out.append(" |"); append_padded(out, name, 12, true);
+    out.append(" |"); append_padded_int(out, partition, 16, false);
+    out.append(" |"); append_padded_int(out, size, 5, false);
+    out.append(" |"); append_padded(out, state, 8, true);
+    out.append(" |");
+}
+
+static string_view trim(string_view s) {
+    while (!s.empty() && s.front() == ' ') s.remove_prefix(1);
+    while (!s.empty() && s.back() == ' ') s.remove_suffix(1);
+    return s;
+}
+
+static uint64_t zigzag(long long v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static long long unzigzag(uint64_t v) { return (long long)(v >> 1) ^ -(long long)(v & 1); }
+
+static void store_le(uint8_t* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+static uint64_t load_le(const uint8_t* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+// ===== WRITER =====
+
+binary_log_writer::binary_log_writer(const string& path)
+    : fd(::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)), out(log_sink::discard()) {
+    if (fd < 0) throw runtime_error("cannot open " + path + " for writing: " + strerror(errno));
+    out = log_sink::to_fd(fd);
+    char blank[sizeof(binary_log_header)] = {};   // filled in by finish()
+    out.write(string_view(blank, sizeof blank));
+}
+
+binary_log_writer::~binary_log_writer() {
+    out = log_sink::discard();   // flush before closing
+    close(fd);
+}
+
+uint32_t binary_log_writer::intern(string_view s) {
+    auto it = string_ids.find(s);
+    if (it != string_ids.end()) return it->second;
+    if (strings.size() >= MAX_STRINGS) return UINT32_MAX;
+    strings.emplace_back(s);
+    uint32_t id = (uint32_t)strings.size() - 1;
+    string_ids.emplace(strings.back(), id);
+    return id;
+}
+
+void binary_log_writer::put_varint(uint64_t v) {
+    char buf[10];
+    int n = 0;
+    do {
+        uint8_t b = v & 0x7F;
+        v >>= 7;
+        buf[n++] = (char)(b | (v ? 0x80 : 0));
+    } while (v);
+    out.write(string_view(buf, n));
+}
+
+void binary_log_writer::put_signed(long long v) { put_varint(zigzag(v)); }
+
+void binary_log_writer::put_time(long long t) {
+    put_signed(t - prev_time);
+    prev_time = t;
+    binary_log_block& block = index.back();
+    block.min_time = min(block.min_time, t);
+    block.max_time = max(block.max_time, t);
+}
+
+void binary_log_writer::literal(string_view line) {
+    uint32_t id = line.size() <= SHORT_LINE ? intern(line) : UINT32_MAX;
+    if (id != UINT32_MAX) {
+        out.write((char)LINE);
+        put_varint(id);
+        return;
+    }
+    literal_count++;
+    out.write((char)LITERAL);
+    put_varint(line.size());
+    out.write(line);
+}
+
+void binary_log_writer::add_line(string_view line) {
+    if (record_count % INDEX_STEP == 0)
+        index.push_back({record_count, out.bytes() - sizeof(binary_log_header), prev_time, LLONG_MAX, LLONG_MIN});
+    record_count++;
+
+    long long a, b;
+
+    // <t>, <d>, <text>  or  <t>,<d>,<text>
+    size_t c1 = line.find(',');
+    if (c1 != string_view::npos && parse_number(line.substr(0, c1), a)) {
+        bool spaced = c1 + 1 < line.size() && line[c1 + 1] == ' ';
+        string_view sep = spaced ? ", " : ",";
+        string_view rest = line.substr(c1 + sep.size());
+        size_t c2 = rest.find(sep);
+        if (c2 != string_view::npos && parse_number(rest.substr(0, c2), b)) {
+            uint32_t text = intern(rest.substr(c2 + sep.size()));
+            if (text != UINT32_MAX) {
+                out.write((char)(spaced ? EVENT_SPACED : EVENT_TIGHT));
+                put_time(a);
+                put_signed(b);
+                put_varint(text);
+                return;
+            }
+        }
+    }
+
+    // time: <t>; current trace: <label>, <v>
+    static constexpr string_view TIME = "time: ", TRACE = "; current trace: ";
+    if (line.rfind(TIME, 0) == 0) {
+        size_t semi = line.find(TRACE), comma = line.rfind(", ");
+        if (semi != string_view::npos && comma != string_view::npos && comma >= semi + TRACE.size() &&
+            parse_number(line.substr(TIME.size(), semi - TIME.size()), a) &&
+            parse_number(line.substr(comma + 2), b)) {
+            uint32_t label = intern(line.substr(semi + TRACE.size(), comma - semi - TRACE.size()));
+            if (label != UINT32_MAX) {
+                out.write((char)HEADER);
+                put_time(a);
+                put_varint(label);
+                put_signed(b);
+                return;
+            }
+        }
+    }
+
+    // | pid |name |partition | size |state |
+    if (line.size() > 4 && line.rfind("| ", 0) == 0 && line.compare(line.size() - 2, 2, " |") == 0) {
+        string_view cols[5];
+        string_view rest = line.substr(1, line.size() - 2);
+        int n = 0;
+        for (; n < 5 && !rest.empty(); n++) {
+            size_t bar = rest.find('|');
+            cols[n] = rest.substr(0, bar);
+            rest = bar == string_view::npos ? string_view() : rest.substr(bar + 1);
+        }
+        long long pid, partition, size;
+        if (n == 5 && rest.empty() && parse_number(trim(cols[0]), pid) && pid >= 0 &&
+            parse_number(trim(cols[2]), partition) && parse_number(trim(cols[3]), size) && size >= 0) {
+            string_view name = trim(cols[1]), state = trim(cols[4]);
+            for (bool left : {false, true}) {
+                scratch.clear();
+                render_row(scratch, left, pid, name, partition, size, state);
+                if (scratch != line) continue;
+                uint32_t name_id = intern(name), state_id = intern(state);
+                if (name_id == UINT32_MAX || state_id == UINT32_MAX) break;
+                out.write((char)(left ? ROW_LEFT : ROW_RIGHT));
+                put_varint(pid);
+                put_varint(name_id);
+                put_signed(partition);
+                put_varint(size);
+                put_varint(state_id);
+                return;
+            }
+        }
+    }
+
+    // <text>, <v>
+    size_t comma = line.rfind(", ");
+    if (comma != string_view::npos && parse_number(line.substr(comma + 2), a)) {
+        uint32_t text = intern(line.substr(0, comma));
+        if (text != UINT32_MAX) {
+            out.write((char)PAIR);
+            put_varint(text);
+            put_signed(a);
+            return;
+        }
+    }
+
+    literal(line);
+}
+
+void binary_log_writer::finish(bool final_newline) {
+    if (finished) return;
+    finished = true;
+
+    uint64_t strings_offset = out.bytes();
+    put_varint(strings.size());
+    for (const auto& s : strings) { put_varint(s.size()); out.write(s); }
+
+    uint64_t index_offset = out.bytes();
+    put_varint(index.size());
+    for (const auto& block : index) {
+        put_varint(block.record);
+        put_varint(block.offset);
+        put_signed(block.base_time);
+        put_signed(block.min_time);
+        put_signed(block.max_time);
+    }
+    uint64_t file_size = out.bytes();
+    out.flush();
+
+    uint8_t header[sizeof(binary_log_header)] = {};
+    memcpy(header, BINARY_LOG_MAGIC, 8);
+    store_le(header + 8, BINARY_LOG_VERSION, 2);
+    store_le(header + 10, final_newline ? binary_log_header::FINAL_NEWLINE : 0, 2);
+    store_le(header + 16, record_count, 8);
+    store_le(header + 24, sizeof(binary_log_header), 8);
+    store_le(header + 32, strings_offset, 8);
+    store_le(header + 40, index_offset, 8);
+    store_le(header + 48, file_size, 8);
+    if (pwrite(fd, header, sizeof header, 0) != (ssize_t)sizeof header)
+        throw runtime_error(string("binary log header write failed: ") + strerror(errno));
+}
+
+// ===== READER =====
+
+static runtime_error corrupt() { return runtime_error("corrupt binary log"); }
+
+static uint64_t read_varint(const uint8_t*& p, const uint8_t* end) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p >= end) throw corrupt();
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) return v;
+    }
+    throw corrupt();
+}
+
+bool binary_log_reader::is_binary_log(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    char magic[8];
+    bool match = pread(fd, magic, 8, 0) == 8 && memcmp(magic, BINARY_LOG_MAGIC, 8) == 0;
+    close(fd);
+    return match;
+}
+
+binary_log_reader::binary_log_reader(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("cannot open " + path + ": " + strerror(errno));
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(binary_log_header)) {
+        close(fd);
+        throw runtime_error(path + ": not a binary log");
+    }
+    size = (size_t)st.st_size;
+    void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) throw runtime_error(string("mmap failed: ") + strerror(errno));
+    data = static_cast<const uint8_t*>(p);
+
+    try {
+        if (memcmp(data, BINARY_LOG_MAGIC, 8) != 0) throw runtime_error(path + ": not a binary log");
+        memcpy(header.magic, data, 8);
+        header.version = (uint16_t)load_le(data + 8, 2);
+        header.flags = (uint16_t)load_le(data + 10, 2);
+        header.record_count = load_le(data + 16, 8);
+        header.records_offset = load_le(data + 24, 8);
+        header.strings_offset = load_le(data + 32, 8);
+        header.index_offset = load_le(data + 40, 8);
+        header.file_size = load_le(data + 48, 8);
+        if (header.version != BINARY_LOG_VERSION)
+            throw runtime_error(path + ": unsupported binary log version " + to_string(header.version));
+        if (header.file_size != size || header.records_offset > header.strings_offset ||
+            header.strings_offset > header.index_offset || header.index_offset > size)
+            throw runtime_error(path + ": truncated binary log");
+
+        const uint8_t* q = data + header.strings_offset;
+        const uint8_t* end = data + header.index_offset;
+        uint64_t count = read_varint(q, end);
+        strings.reserve(count);
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t len = read_varint(q, end);
+            if (len > (uint64_t)(end - q)) throw corrupt();
+            strings.emplace_back((const char*)q, len);
+            q += len;
+        }
+
+        q = data + header.index_offset;
+        end = data + size;
+        count = read_varint(q, end);
+        for (uint64_t i = 0; i < count; i++) {
+            binary_log_block b;
+            b.record = read_varint(q, end);
+            b.offset = read_varint(q, end);
+            b.base_time = unzigzag(read_varint(q, end));
+            b.min_time = unzigzag(read_varint(q, end));
+            b.max_time = unzigzag(read_varint(q, end));
+            if (b.record > header.record_count ||
+                b.offset > header.strings_offset - header.records_offset) throw corrupt();
+            index.push_back(b);
+        }
+    } catch (...) {
+        munmap(const_cast<uint8_t*>(data), size);
+        throw;
+    }
+}
+
+binary_log_reader::~binary_log_reader() {
+    munmap(const_cast<uint8_t*>(data), size);
+}
+
+binary_log_reader::cursor binary_log_reader::begin() const {
+    return cursor(*this, data + header.records_offset, header.record_count, 0);
+}
+
+binary_log_reader::cursor binary_log_reader::seek(long long time) const {
+    for (const auto& block : index) {
+        if (block.max_time < time) continue;
+        cursor c(*this, data + header.records_offset + block.offset,
+                 header.record_count - block.record, block.base_time);
+        // Step to the first timed record at or after `time`
+        string scratch;
+        for (;;) {
+            cursor at = c;
+            if (!c.next(scratch)) return c;
+            if (c.timed() && c.time() >= time) return at;
+        }
+    }
+    return cursor(*this, data + header.strings_offset, 0, 0);
+}
+
+uint64_t binary_log_reader::cursor::varint() { return read_varint(pos, end); }
+long long binary_log_reader::cursor::signed_varint() { return unzigzag(varint()); }
+
+string_view binary_log_reader::cursor::string_ref() {
+    uint64_t id = varint();
+    if (id >= log->strings.size()) throw corrupt();
+    return log->strings[id];
+}
+
+bool binary_log_reader::cursor::next(string& line) {
+    if (left == 0) return false;
+    left--;
+    line.clear();
+    was_timed = false;
+    if (pos >= end) throw corrupt();
+
+    switch (*pos++) {
+    case LITERAL: {
+        uint64_t len = varint();
+        if (len > (uint64_t)(end - pos)) throw corrupt();
+        line.append((const char*)pos, len);
+        pos += len;
+        break;
+    }
+    case LINE:
+        line.append(string_ref());
+        break;
+    case EVENT_SPACED:
+    case EVENT_TIGHT: {
+        bool spaced = pos[-1] == EVENT_SPACED;
+        prev_time += signed_varint();
+        was_timed = true;
+        long long duration = signed_varint();
+        string_view text = string_ref();
+        const char* sep = spaced ? ", " : ",";
+        append_int(line, prev_time); line.append(sep);
+        append_int(line, duration); line.append(sep);
+        line.append(text);
+        break;
+    }
+    case HEADER: {
+        prev_time += signed_varint();
+        was_timed = true;
+        string_view label = string_ref();
+        long long val = signed_varint();
+        line.append("time: "); append_int(line, prev_time);
+        line.append("; current trace: "); line.append(label);
+        line.append(", "); append_int(line, val);
+        break;
+    }
+    case ROW_RIGHT:
+    case ROW_LEFT: {
+        bool left_pid = pos[-1] == ROW_LEFT;
+        long long pid = (long long)varint();
+        string_view name = string_ref();
+        long long partition = signed_varint();
+        long long size = (long long)varint();
+        string_view state = string_ref();
+        render_row(line, left_pid, pid, name, partition, size, state);
+        break;
+    }
+    case PAIR: {
+        string_view text = string_ref();
+        line.append(text); line.append(", "); append_int(line, signed_varint());
+        break;
+    }
+    default:
+        throw corrupt();
+    }
+    return true;
+}
+
+bool binary_line_reader::next(string_view& line) {
+    if (!at.next(buffer)) return false;
+    line = buffer;
+    lines_read++;
+    return true;
+}
+
+// ===== CONVERTERS =====
+
+void encode_text_file(const string& in, const string& out_path, uint64_t* records, uint64_t* literals) {
+    int fd = in == "-" ? STDIN_FILENO : ::open(in.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("cannot open " + in + ": " + strerror(errno));
+
+    binary_log_writer writer(out_path);
+    string buffer;
+    size_t pos = 0;
+    bool final_newline = false;
+    try {
+        for (;;) {
+            size_t old = buffer.size();
+            buffer.resize(old + (1 << 16));
+            ssize_t n;
+            do { n = read(fd, &buffer[old], 1 << 16); } while (n < 0 && errno == EINTR);
+            if (n < 0) throw runtime_error(string("read failed: ") + strerror(errno));
+            buffer.resize(old + (size_t)n);
+            if (n == 0) break;
+
+            for (;;) {
+                const void* nl = memchr(buffer.data() + pos, '\n', buffer.size() - pos);
+                if (!nl) break;
+                size_t end = (const char*)nl - buffer.data();
+                writer.add_line(string_view(buffer).substr(pos, end - pos));
+                pos = end + 1;
+                final_newline = true;
+            }
+            buffer.erase(0, pos);
+            pos = 0;
+        }
+        if (!buffer.empty()) {
+            writer.add_line(buffer);
+            final_newline = false;
+        }
+    } catch (...) {
+        if (fd != STDIN_FILENO) close(fd);
+        throw;
+    }
+    if (fd != STDIN_FILENO) close(fd);
+
+    writer.finish(final_newline);
+    if (records) *records = writer.records();
+    if (literals) *literals = writer.literals();
+}
+
+void decode_binary_file(const string& in, log_sink& out, long long from_time) {
+    binary_log_reader log(in);
+    binary_log_reader::cursor at = from_time == LLONG_MIN ? log.begin() : log.seek(from_time);
+    string line;
+    while (at.next(line)) {
+        out.write(line);
+        if (!at.done() || log.final_newline()) out.write('\n');
+    }
+    out.flush();
+}
@@ -0,0 +1,175 @@
+#ifndef BINARY_LOG_HPP_
+#define BINARY_LOG_HPP_
+
+#include <climits>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "log_writer.hpp"
+#include "trace_reader.hpp"
+
+// ======================== BINARY LOG FORMAT ========================
+
+// Compact form of any of the simulator's line-oriented text files (traces,
+// execution logs, system status logs). Each line becomes one record:
+//   EVENT   "<t>, <d>, <text>" or "<t>,<d>,<text>"   delta time, duration, text id
+//   HEADER  "time: <t>; current trace: <label>, <v>" delta time, label id, value
+//   ROW     a system status table row                  pid, name id, partition, size, state id
+//   PAIR    "<text>, <v>" (trace lines)                text id, value
+//   LINE    any other short line (table borders)       text id
+//   LITERAL anything else, stored verbatim
+// Integers are LEB128 varints (signed ones zigzagged) and times are deltas
+// from the previous timed record, so out-of-order times cost nothing extra.
+// Repeated text goes through a string table. A line is only given a
+// structured record if it renders back to exactly the same bytes, so
+// decoding always reproduces the original file byte for byte.
+//
+// File layout (little endian):
+//   header  64 bytes, see binary_log_header
+//   records
+//   strings varint count, then varint length + bytes each
+//   index   varint count, then one entry per INDEX_STEP records:
+//           record number, byte offset, base time, min time, max time
+// The file is read through mmap; the index lets a reader start decoding at
+// the first block that can contain a given time.
+
+constexpr char BINARY_LOG_MAGIC[8] = {'S', 'I', 'M', 'B', 'L', 'O', 'G', '\0'};
+constexpr std::uint16_t BINARY_LOG_VERSION = 1;
+
+struct binary_log_header {
+    char magic[8];
+    std::uint16_t version;
+    std::uint16_t flags;            // FINAL_NEWLINE
+    std::uint32_t reserved;
+    std::uint64_t record_count;
+    std::uint64_t records_offset;
+    std::uint64_t strings_offset;
+    std::uint64_t index_offset;
+    std::uint64_t file_size;
+    std::uint64_t reserved2;
+
+    static constexpr std::uint16_t FINAL_NEWLINE = 1;   // the last line ended with '\n'
+};
+static_assert(sizeof(binary_log_header) == 64, "binary_log_header must stay 64 bytes");
+
+// One index entry: where a run of INDEX_STEP records starts, the time delta
+// base to decode it from, and the range of times inside it
+struct binary_log_block {
+    std::uint64_t record, offset;   // offset from the start of the records
+    long long base_time, min_time, max_time;
+};
+
+// Streams records to `path`; nothing is usable until finish()
+class binary_log_writer {
+public:
+    static constexpr std::uint64_t INDEX_STEP = 1024;
+    static constexpr std::size_t MAX_STRINGS = 1 << 20;   // past this, new text is stored inline
+    static constexpr std::size_t SHORT_LINE = 80;         // literal lines up to this long are interned
+
+    explicit binary_log_writer(const std::string& path);   // throws std::runtime_error
+    ~binary_log_writer();
+    binary_log_writer(const binary_log_writer&) = delete;
+    binary_log_writer& operator=(const binary_log_writer&) = delete;
+
+    void add_line(std::string_view line);
+    void finish(bool final_newline);
+
+    std::uint64_t records() const { return record_count; }
+    std::uint64_t literals() const { return literal_count; }
+
+private:
+    std::uint32_t intern(std::string_view s);   // UINT32_MAX once the table is full
+    void put_varint(std::uint64_t v);
+    void put_signed(long long v);
+    void put_time(long long t);
+    void literal(std::string_view line);
+
+    int fd;
+    log_sink out;
+    std::uint64_t record_count = 0, literal_count = 0;
+    long long prev_time = 0;
+    std::deque<std::string> strings;   // stable addresses for the map's keys
+    std::unordered_map<std::string_view, std::uint32_t> string_ids;
+    std::vector<binary_log_block> index;
+    std::string scratch;
+    bool finished = false;
+};
+
+// Read-only view of a finished file, memory-mapped
+class binary_log_reader {
+public:
+    explicit binary_log_reader(const std::string& path);   // throws std::runtime_error
+    ~binary_log_reader();
+    binary_log_reader(const binary_log_reader&) = delete;
+    binary_log_reader& operator=(const binary_log_reader&) = delete;
+
+    // Decodes records in order, rendering each back to its text line
+    class cursor {
+    public:
+        bool next(std::string& line);
+        bool done() const { return left == 0; }
+        long long time() const { return prev_time; }   // of the last timed record
+        bool timed() const { return was_timed; }       // the last record carried a time
+
+    private:
+        friend class binary_log_reader;
+        cursor(const binary_log_reader& log, const std::uint8_t* pos, std::uint64_t left, long long base)
+            : log(&log), pos(pos), end(log.data + log.header.strings_offset), left(left), prev_time(base) {}
+        std::uint64_t varint();
+        long long signed_varint();
+        std::string_view string_ref();
+
+        const binary_log_reader* log;
+        const std::uint8_t* pos;
+        const std::uint8_t* end;
+        std::uint64_t left;
+        long long prev_time;
+        bool was_timed = false;
+    };
+
+    cursor begin() const;
+    // Positioned at the first record with time >= `time` (untimed records,
+    // like status table rows, follow the header before them)
+    cursor seek(long long time) const;
+
+    std::uint64_t records() const { return header.record_count; }
+    bool final_newline() const { return header.flags & binary_log_header::FINAL_NEWLINE; }
+    std::size_t string_count() const { return strings.size(); }
+    std::size_t index_size() const { return index.size(); }
+    std::uint64_t file_size() const { return size; }
+
+    static bool is_binary_log(const std::string& path);
+
+private:
+    const std::uint8_t* data = nullptr;
+    std::size_t size = 0;
+    binary_log_header header;
+    std::vector<std::string_view> strings;
+    std::vector<binary_log_block> index;
+};
+
+// Lets every line_reader user (the trace compiler, simulate_stream) take
+// binary traces; line_reader::open picks it when the file starts with the magic
+class binary_line_reader : public line_reader {
+public:
+    explicit binary_line_reader(const std::string& path) : log(path), at(log.begin()) {}
+    bool next(std::string_view& line) override;
+
+private:
+    binary_log_reader log;
+    binary_log_reader::cursor at;
+    std::string buffer;
+};
+
+// txt -> bin: reads `in` ("-" for stdin) and writes `out`. Returns the writer's
+// record and literal counts through the pointers when given.
+void encode_text_file(const std::string& in, const std::string& out,
+                      std::uint64_t* records = nullptr, std::uint64_t* literals = nullptr);
+// bin -> txt, starting at `from_time` when given
+void decode_binary_file(const std::string& in, log_sink& out, long long from_time = LLONG_MIN);
+
+#endif
@@ -4,4 +4,22 @@ else
     rm -f bin/*
 fi
 
-g++ -g -O0 -I . -o bin/sim main.cpp Interrupts_101297993_101302793.cpp
+# PROFILE=1 ./build.sh compiles in the --profile instrumentation
+if [ "$PROFILE" = "1" ]; then
+    CXXFLAGS="-DSIM_PROFILE"
+fi
+
+SOURCES="Interrupts_101297993_101302793.cpp trace_compiler.cpp trace_reader.cpp text_scan.cpp binary_log.cpp log_writer.cpp profile.cpp partition_manager.cpp program_catalog.cpp program_cache.cpp nested_simulator.cpp event_engine.cpp pcb_table.cpp dispatch_table.cpp checkpoint.cpp fixed_timings.cpp"
+
+g++ $CXXFLAGS -g -O0 -I . -pthread -o bin/sim main.cpp thread_pool.cpp parallel_nested.cpp sim_runner.cpp sim_server.cpp sim_sweep.cpp $SOURCES
+g++ $CXXFLAGS -O2 -I . -o bin/bench_trace bench_trace.cpp $SOURCES
+g++ $CXXFLAGS -O2 -I . -o bin/bench_parse bench_parse.cpp $SOURCES
+g++ $CXXFLAGS -O2 -I . -o bin/bench_partitions bench_partitions.cpp partition_manager.cpp trace_reader.cpp text_scan.cpp binary_log.cpp log_writer.cpp profile.cpp
+g++ $CXXFLAGS -O2 -I . -o bin/bench_catalog bench_catalog.cpp $SOURCES
+g++ $CXXFLAGS -O2 -I . -o bin/bench_events bench_events.cpp $SOURCES
+g++ $CXXFLAGS -O2 -I . -o bin/status_replay status_replay.cpp pcb_table.cpp trace_compiler.cpp trace_reader.cpp text_scan.cpp binary_log.cpp log_writer.cpp profile.cpp
+g++ $CXXFLAGS -O2 -I . -o bin/simbin simbin.cpp binary_log.cpp trace_reader.cpp text_scan.cpp log_writer.cpp profile.cpp
+g++ $CXXFLAGS -O2 -I . -o bin/tracegen tracegen.cpp workload_gen.cpp log_writer.cpp profile.cpp
+g++ $CXXFLAGS -O2 -I . -pthread -o bin/bench bench.cpp workload_gen.cpp thread_pool.cpp parallel_nested.cpp $SOURCES
+g++ $CXXFLAGS -O2 -I . -o bin/simc simc.cpp log_writer.cpp profile.cpp
+g++ $CXXFLAGS -O2 -I . -pthread -o bin/sim_diff sim_diff.cpp workload_gen.cpp thread_pool.cpp parallel_nested.cpp sim_runner.cpp $SOURCES
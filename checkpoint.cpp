@@ -0,0 +1,212 @@
+#include "checkpoint.hpp"
+#include "text_scan.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <sys/stat.h>
+
+using namespace std;
+
+static const char MAGIC[8] = {'S', 'I', 'M', 'C', 'K', 'P', 'T', '\0'};
+
+// ===== ENCODING =====
+
+namespace {
+
+struct encoder {
+    string out;
+
+    void varint(uint64_t v) {
+        while (v >= 0x80) { out += (char)(v | 0x80); v >>= 7; }
+        out += (char)v;
+    }
+    void signed_varint(long long v) { varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); }
+    void str(const string& s) { varint(s.size()); out += s; }
+    void pcb(const PCB& p) {
+        varint(p.PID); signed_varint(p.PPID); str(p.program_name);
+        varint(p.size); signed_varint(p.partition_number);
+    }
+};
+
+struct decoder {
+    const string& in;
+    size_t pos;
+    size_t end;
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos >= end) throw runtime_error("truncated checkpoint");
+            uint8_t b = (uint8_t)in[pos++];
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throw runtime_error("bad varint in checkpoint");
+    }
+    long long signed_varint() { uint64_t v = varint(); return (long long)(v >> 1) ^ -(long long)(v & 1); }
+    string str() {
+        uint64_t n = varint();
+        if (n > end - pos) throw runtime_error("truncated checkpoint");
+        string s = in.substr(pos, n);
+        pos += n;
+        return s;
+    }
+    PCB pcb() {
+        unsigned pid = (unsigned)varint();
+        int ppid = (int)signed_varint();
+        string name = str();
+        unsigned size = (unsigned)varint();
+        int partition = (int)signed_varint();
+        return PCB(pid, ppid, name, size, partition);
+    }
+};
+
+}   // namespace
+
+void write_checkpoint(const string& path, const checkpoint& state) {
+    encoder e;
+    e.out.append(MAGIC, sizeof MAGIC);
+    e.varint(checkpoint::VERSION);
+    e.str(state.trace);
+    e.varint(state.trace_size);
+    e.signed_varint(state.trace_mtime_ns);
+    e.varint(state.tables_hash);
+    e.varint(state.line);
+    e.varint(state.exec_bytes);
+    e.varint(state.sys_bytes);
+    e.signed_varint(state.time);
+    e.varint(state.next_pid);
+    e.varint(state.fork_failures);
+    e.varint((state.fixed_timings ? 1 : 0) | (state.delta_status ? 2 : 0));
+    e.varint(state.timing_state);
+    e.varint(state.timing_fired.size());
+    for (uint32_t n : state.timing_fired) e.varint(n);
+    e.pcb(state.current);
+    e.varint(state.wait_queue.size());
+    for (const PCB& p : state.wait_queue) e.pcb(p);
+    e.varint(state.status_changes.size());
+    for (uint32_t pid : state.status_changes) e.varint(pid);
+    e.varint((uint64_t)state.policy);
+    e.varint(state.partition_sizes.size());
+    for (size_t i = 0; i < state.partition_sizes.size(); i++) {
+        e.varint(state.partition_sizes[i]);
+        e.str(i < state.partition_owners.size() ? state.partition_owners[i] : string());
+    }
+    e.varint(state.peak_partitions);
+    uint64_t hash = fnv1a(e.out);
+    for (int i = 0; i < 8; i++) e.out += (char)(hash >> (8 * i));
+
+    string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) throw runtime_error("cannot open " + tmp + ": " + strerror(errno));
+    bool ok = fwrite(e.out.data(), 1, e.out.size(), f) == e.out.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        throw runtime_error("failed writing checkpoint " + path);
+    }
+}
+
+checkpoint read_checkpoint(const string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) throw runtime_error("cannot open " + path + ": " + strerror(errno));
+    string bytes;
+    char buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof buf, f)) > 0) bytes.append(buf, n);
+    fclose(f);
+
+    if (bytes.size() < sizeof MAGIC + 8 || memcmp(bytes.data(), MAGIC, sizeof MAGIC) != 0)
+        throw runtime_error(path + " is not a checkpoint");
+    size_t body = bytes.size() - 8;
+    uint64_t stored = 0;
+    for (int i = 0; i < 8; i++) stored |= (uint64_t)(uint8_t)bytes[body + i] << (8 * i);
+    if (stored != fnv1a(string_view(bytes).substr(0, body))) throw runtime_error(path + " is corrupt (checksum mismatch)");
+
+    decoder d{bytes, sizeof MAGIC, body};
+    if (d.varint() != checkpoint::VERSION) throw runtime_error(path + " has an unsupported checkpoint version");
+    checkpoint state;
+    state.trace = d.str();
+    state.trace_size = d.varint();
+    state.trace_mtime_ns = d.signed_varint();
+    state.tables_hash = d.varint();
+    state.line = d.varint();
+    state.exec_bytes = d.varint();
+    state.sys_bytes = d.varint();
+    state.time = (int)d.signed_varint();
+    state.next_pid = (unsigned)d.varint();
+    state.fork_failures = (unsigned)d.varint();
+    uint64_t flags = d.varint();
+    state.fixed_timings = flags & 1;
+    state.delta_status = flags & 2;
+    state.timing_state = (uint32_t)d.varint();
+    for (uint64_t i = d.varint(); i > 0; i--) state.timing_fired.push_back((uint32_t)d.varint());
+    state.current = d.pcb();
+    for (uint64_t i = d.varint(); i > 0; i--) state.wait_queue.push_back(d.pcb());
+    for (uint64_t i = d.varint(); i > 0; i--) state.status_changes.push_back((uint32_t)d.varint());
+    uint64_t policy = d.varint();
+    if (policy > (uint64_t)placement_policy::WORST_FIT) throw runtime_error(path + ": bad placement policy");
+    state.policy = (placement_policy)policy;
+    for (uint64_t i = d.varint(); i > 0; i--) {
+        state.partition_sizes.push_back((unsigned)d.varint());
+        state.partition_owners.push_back(d.str());
+    }
+    state.peak_partitions = d.varint();
+    if (d.pos != body) throw runtime_error(path + ": trailing bytes in checkpoint");
+    return state;
+}
+
+// ===== TRACE STAMP =====
+
+void stamp_trace(checkpoint& state, const string& path) {
+    state.trace = path;
+    state.trace_size = 0;
+    state.trace_mtime_ns = 0;
+    if (path == "-") return;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) throw runtime_error("cannot stat " + path + ": " + strerror(errno));
+    state.trace = filesystem::weakly_canonical(path).string();
+    state.trace_size = (uint64_t)st.st_size;
+    state.trace_mtime_ns = (long long)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+void check_trace(const checkpoint& state, const string& path) {
+    if (path == "-" || state.trace == "-")
+        throw runtime_error("cannot resume a trace read from stdin (it cannot be checked against the checkpoint)");
+    checkpoint now;
+    stamp_trace(now, path);
+    if (now.trace != state.trace)
+        throw runtime_error("the checkpoint was taken from " + state.trace + ", not " + now.trace);
+    if (now.trace_size != state.trace_size || now.trace_mtime_ns != state.trace_mtime_ns)
+        throw runtime_error(now.trace + " has changed since the checkpoint was taken");
+}
+
+// ===== SCHEDULE =====
+
+checkpoint_schedule::checkpoint_schedule(string _dir, uint64_t _every_lines, long long _every_time,
+                                         string _trace)
+    : dir(move(_dir)), every_lines(_every_lines), every_time(_every_time) {
+    start_at(0, 0);
+    if (enabled()) {
+        stamp_trace(source, _trace);
+        filesystem::create_directories(dir);
+    }
+}
+
+void checkpoint_schedule::start_at(uint64_t line, long long time) {
+    if (every_lines > 0) next_line = line + every_lines;
+    if (every_time > 0) next_time = (time / every_time + 1) * every_time;
+}
+
+void checkpoint_schedule::write(const trace_simulator& sim, uint64_t line) {
+    checkpoint state;
+    sim.save(state);
+    state.trace = source.trace;
+    state.trace_size = source.trace_size;
+    state.trace_mtime_ns = source.trace_mtime_ns;
+    state.line = line;
+    write_checkpoint(dir + "/checkpoint_" + to_string(line) + ".bin", state);
+    count++;
+    start_at(line, sim.time());
+}
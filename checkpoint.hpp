@@ -0,0 +1,88 @@
+#ifndef CHECKPOINT_HPP_
+#define CHECKPOINT_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "interrupts_101297993_101302793.hpp"
+
+// ========================= CHECKPOINTS =========================
+
+// Everything the streaming simulator needs to carry on from the middle of a
+// trace, and what it was run on so a resume with other inputs is refused.
+// Files start with the magic "SIMCKPT\0" and a version, then hold LEB128
+// varints (signed ones zigzagged) and length-prefixed strings, and end with
+// an FNV-1a hash of everything before it.
+struct checkpoint {
+    static constexpr std::uint32_t VERSION = 5;
+
+    std::string trace;            // canonical path of the trace, "-" for stdin
+    std::uint64_t trace_size = 0;
+    long long trace_mtime_ns = 0;
+    std::uint64_t tables_hash = 0;   // dispatch table (costs, delays, ISRs) and program sizes
+
+    std::uint64_t line = 0;       // trace lines consumed
+    std::uint64_t exec_bytes = 0; // execution / status log sizes at this point
+    std::uint64_t sys_bytes = 0;
+    int time = 0;
+    unsigned next_pid = 1;
+    unsigned fork_failures = 0;
+    PCB current{0, -1, "init", 1, -1};
+    std::deque<PCB> wait_queue;
+    bool delta_status = false;                    // the status log is --status-delta
+    std::vector<std::uint32_t> status_changes;   // PIDs changed since the last snapshot
+
+    placement_policy policy = placement_policy::LEGACY;
+    std::vector<unsigned> partition_sizes;
+    std::vector<std::string> partition_owners;   // "" = free
+    std::uint64_t peak_partitions = 0;           // partition_manager::peak_used()
+
+    // Where trace_simulator is in its fixed timings (fixed_timings.hpp)
+    std::uint32_t timing_state = 0;
+    std::vector<std::uint32_t> timing_fired;   // times each rule has fired
+    bool fixed_timings = false;
+};
+
+// Both throw std::runtime_error. Writes go to a temporary file that is
+// renamed into place, so a crash never leaves a torn checkpoint.
+void write_checkpoint(const std::string& path, const checkpoint& state);
+checkpoint read_checkpoint(const std::string& path);
+
+// Records `path` (canonical path, size and mtime) as the checkpoint's trace
+void stamp_trace(checkpoint& state, const std::string& path);
+// Throws std::runtime_error unless `path` is the trace `state` was taken
+// from, unchanged since. A trace read from stdin cannot be checked and is
+// refused.
+void check_trace(const checkpoint& state, const std::string& path);
+
+// Decides when simulate_stream writes checkpoints: every `every_lines`
+// trace lines, and/or each time simulated time passes another multiple of
+// `every_time`. Files are <dir>/checkpoint_<line>.bin.
+class checkpoint_schedule {
+public:
+    checkpoint_schedule(std::string dir, std::uint64_t every_lines, long long every_time,
+                        std::string trace);
+
+    bool enabled() const { return every_lines > 0 || every_time > 0; }
+    bool due(std::uint64_t line, long long time) const {
+        return (every_lines > 0 && line >= next_line) || (every_time > 0 && time >= next_time);
+    }
+    // Starts counting from a resumed position
+    void start_at(std::uint64_t line, long long time);
+    void write(const trace_simulator& sim, std::uint64_t line);
+
+    std::size_t written() const { return count; }
+
+private:
+    std::string dir;
+    checkpoint source;   // only the trace stamp is filled in
+    std::uint64_t every_lines;
+    long long every_time;
+    std::uint64_t next_line = 0;
+    long long next_time = 0;
+    std::size_t count = 0;
+};
+
+#endif
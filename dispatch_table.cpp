@@ -0,0 +1,137 @@
+#include "dispatch_table.hpp"
+#include "interrupts_101297993_101302793.hpp"
+#include "profile.hpp"
+#include "text_scan.hpp"
+#include <charconv>
+
+using namespace std;
+
+// ===== COST FILE =====
+
+isr_cost_model load_isr_costs(const string& path, const isr_costs& defaults) {
+    isr_cost_model model;
+    model.defaults = defaults;
+    auto reader = line_reader::open(path);
+    string_view line;
+    while (reader->next(line)) {
+        if (line.find_first_not_of(" \t\n\v\f\r") == string_view::npos) continue;
+
+        auto fail = [&](const string& why) {
+            return runtime_error(path + ":" + to_string(reader->line_number()) + ": " + why);
+        };
+        // Fields up to the sixth are parsed; more only need counting
+        int v[6];
+        size_t count = 0;
+        for (size_t pos = 0, comma = 0; comma != string_view::npos; pos = comma + 1, count++) {
+            comma = line.find(',', pos);
+            string_view field = line.substr(pos, comma == string_view::npos ? string_view::npos : comma - pos);
+            if (count < 6 && (!parse_int_exact(field, v[count]) || v[count] < 0))
+                throw fail("bad number '" + string(field) + "'");
+        }
+        if (count < 2 || count > 6)
+            throw fail("expected 'vector, context_save[, mode_switch, find_vector, load_pc, iret]'");
+
+        isr_costs c = defaults;
+        c.context_save = v[1];
+        if (count > 2) c.mode_switch = v[2];
+        if (count > 3) c.find_vector = v[3];
+        if (count > 4) c.load_pc = v[4];
+        if (count > 5) c.iret = v[5];
+        model.per_vector[(unsigned)v[0]] = c;
+    }
+    return model;
+}
+
+// ===== TABLE =====
+
+dispatch_table::dispatch_table(const vector<string>& vectors, const vector<int>& delays,
+                               const isr_cost_model& costs)
+    : load_rate(costs.load_rate) {
+    static const char HEX[] = "0123456789ABCDEF";
+    entries.resize(max(vectors.size(), delays.size()));
+    for (size_t v = 0; v < entries.size(); v++) {
+        compiled_entry& e = entries[v];
+        entry& info = e.info;
+        info.costs = costs.of((unsigned)v);
+        info.entry_cost = info.costs.entry();
+        info.has_isr = v < vectors.size();
+        info.has_device = v < delays.size();
+        if (info.has_isr) info.isr = vectors[v];
+        if (info.has_device) info.delay = delays[v];
+
+        // Same text intr_boilerplate formats on every interrupt
+        char addr[16];
+        int n = 0;
+        for (unsigned a = ADDR_BASE + (unsigned)v * VECTOR_SIZE; a != 0 || n < 4; a >>= 4) addr[n++] = HEX[a & 0xF];
+
+        string& t = e.text;
+        t += ','; t += to_string(info.costs.mode_switch); t += ",switch to kernel mode\n";
+        e.ends[SWITCH] = (uint32_t)t.size();
+        t += ','; t += to_string(info.costs.context_save); t += ",context saved\n";
+        e.ends[SAVE] = (uint32_t)t.size();
+        t += ','; t += to_string(info.costs.find_vector); t += ",find vector "; t += to_string(v); t += " in 0x";
+        while (n > 0) t += addr[--n];
+        t += '\n';
+        e.ends[FIND] = (uint32_t)t.size();
+        t += ','; t += to_string(info.costs.load_pc); t += ",load "; t += info.isr; t += " into PC\n";
+        e.ends[LOAD] = (uint32_t)t.size();
+        t += ", "; t += to_string(info.delay); t += ", SYSCALL ISR\n";
+        e.ends[SYSCALL_ISR] = (uint32_t)t.size();
+        t += ", "; t += to_string(info.delay); t += ", END_IO ISR\n";
+        e.ends[END_IO_ISR] = (uint32_t)t.size();
+        t += ", "; t += to_string(info.costs.iret); t += ", IRET\n";
+        e.ends[IRET] = (uint32_t)t.size();
+    }
+}
+
+// FNV-1a over the rendered lines, which spell out every cost, delay and address
+uint64_t dispatch_table::fingerprint() const {
+    uint64_t h = FNV1A_SEED;
+    for (const compiled_entry& e : entries) {
+        char flags = (char)((e.info.has_isr ? 1 : 0) | (e.info.has_device ? 2 : 0));
+        h = fnv1a(string_view(&flags, 1), h);
+        h = fnv1a(e.text, h);
+    }
+    char rate[16];
+    return fnv1a(string_view(rate, to_chars(rate, rate + sizeof rate, load_rate).ptr - rate), h);
+}
+
+const dispatch_table::compiled_entry& dispatch_table::checked(int vector) const {
+    if (!contains(vector))
+        throw runtime_error("interrupt " + to_string(vector) + " is past the end of the vector table");
+    return entries[vector];
+}
+
+const dispatch_table::entry& dispatch_table::at(int vector) const {
+    return checked(vector).info;
+}
+
+int dispatch_table::enter(log_sink& log, int t, int vector) const {
+    PROFILE_SCOPE(profile_counter::FORMAT_BOILERPLATE);
+    if (!contains(vector) || !entries[vector].info.has_isr)
+        throw runtime_error("interrupt " + to_string(vector) + " is past the end of the vector table");
+    const compiled_entry& e = entries[vector];
+    const isr_costs& c = e.info.costs;
+    if (!log.enabled()) return t + e.info.entry_cost;
+
+    log.write_int(t); log.write(text(e, SWITCH)); t += c.mode_switch;
+    log.write_int(t); log.write(text(e, SAVE)); t += c.context_save;
+    log.write_int(t); log.write(text(e, FIND)); t += c.find_vector;
+    log.write_int(t); log.write(text(e, LOAD)); t += c.load_pc;
+    return t;
+}
+
+int dispatch_table::iret(log_sink& log, int t, int vector) const {
+    const compiled_entry& e = checked(vector);
+    log.write_int(t); log.write(text(e, IRET));
+    return t + e.info.costs.iret;
+}
+
+int dispatch_table::service(log_sink& log, int t, int vector, opcode op) const {
+    t = enter(log, t, vector);
+    const compiled_entry& e = entries[vector];
+    log.write_int(t); log.write(text(e, op == opcode::SYSCALL ? SYSCALL_ISR : END_IO_ISR));
+    t += e.info.delay;
+    log.write_int(t); log.write(text(e, IRET));
+    return t + e.info.costs.iret;
+}
@@ -0,0 +1,114 @@
+#ifndef DISPATCH_TABLE_HPP_
+#define DISPATCH_TABLE_HPP_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "log_writer.hpp"
+#include "trace_compiler.hpp"
+
+// ====================== INTERRUPT DISPATCH ======================
+
+// Cost of each kernel step of one interrupt; the defaults are the
+// assignment's fixed timings
+struct isr_costs {
+    int mode_switch = 1;    // switch to kernel mode
+    int context_save = 10;
+    int find_vector = 1;
+    int load_pc = 1;        // load the ISR address into the PC
+    int iret = 1;
+
+    int entry() const { return mode_switch + context_save + find_vector + load_pc; }
+
+    bool operator==(const isr_costs& o) const {
+        return mode_switch == o.mode_switch && context_save == o.context_save &&
+               find_vector == o.find_vector && load_pc == o.load_pc && iret == o.iret;
+    }
+    bool operator!=(const isr_costs& o) const { return !(*this == o); }
+};
+
+// Costs for every vector, with per-vector overrides
+struct isr_cost_model {
+    isr_costs defaults;
+    std::map<unsigned, isr_costs> per_vector;
+    int load_rate = 15;   // ms per MB an EXEC loads into memory
+
+    const isr_costs& of(unsigned vector) const {
+        auto it = per_vector.find(vector);
+        return it == per_vector.end() ? defaults : it->second;
+    }
+
+    bool operator==(const isr_cost_model& o) const {
+        return defaults == o.defaults && per_vector == o.per_vector && load_rate == o.load_rate;
+    }
+    bool operator!=(const isr_cost_model& o) const { return !(*this == o); }
+};
+
+// One line per vector: "vector, context_save[, mode_switch, find_vector,
+// load_pc, iret]". Fields left out keep `defaults`. Throws
+// std::runtime_error naming the line on bad input.
+isr_cost_model load_isr_costs(const std::string& path, const isr_costs& defaults = {});
+
+// The vector and device tables compiled once at load time. Each entry holds
+// everything one interrupt needs: the boilerplate lines already rendered
+// (minus their timestamps), the ISR address, the total entry cost and the
+// device delay. An interrupt is then a bounds check plus a few appends.
+class dispatch_table {
+public:
+    dispatch_table(const std::vector<std::string>& vectors, const std::vector<int>& delays,
+                   const isr_cost_model& costs = {});
+
+    struct entry {
+        isr_costs costs;
+        int entry_cost = 0;          // switch + save + find + load
+        int delay = 0;               // device delay; 0 when the device table has no row
+        bool has_isr = false;        // false past the end of the vector table
+        bool has_device = false;     // false past the end of the device table
+        std::string isr;             // ISR address, e.g. "0X01E3"
+    };
+
+    std::size_t size() const { return entries.size(); }
+    bool contains(int vector) const { return (unsigned)vector < entries.size(); }
+    const entry& at(int vector) const;   // throws std::runtime_error when out of range
+
+    // The four kernel-entry lines; returns the time after them. Throws
+    // std::runtime_error if `vector` has no ISR address.
+    int enter(log_sink& log, int t, int vector) const;
+
+    // "<t>, <iret>, IRET"; returns the time after it
+    int iret(log_sink& log, int t, int vector) const;
+
+    // A whole SYSCALL / END_IO: entry, the ISR for the device delay, IRET
+    int service(log_sink& log, int t, int vector, opcode op) const;
+
+    // Time for EXEC to load a program of `size_mb`
+    int load_time(unsigned size_mb) const { return (int)size_mb * load_rate; }
+
+    // Hash of every cost, delay, ISR address and the load rate; two tables
+    // with the same fingerprint time every interrupt the same
+    std::uint64_t fingerprint() const;
+
+private:
+    // Pre-rendered line tails, stored back to back in entry_text
+    enum segment : std::uint8_t { SWITCH, SAVE, FIND, LOAD, SYSCALL_ISR, END_IO_ISR, IRET, SEGMENTS };
+
+    struct compiled_entry {
+        entry info;
+        std::string text;
+        std::uint32_t ends[SEGMENTS];
+    };
+
+    std::string_view text(const compiled_entry& e, segment s) const {
+        std::uint32_t from = s == 0 ? 0 : e.ends[s - 1];
+        return std::string_view(e.text).substr(from, e.ends[s] - from);
+    }
+    const compiled_entry& checked(int vector) const;
+
+    std::vector<compiled_entry> entries;
+    int load_rate;
+};
+
+#endif
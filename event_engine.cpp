@@ -0,0 +1,347 @@
+#include "event_engine.hpp"
+#include "profile.hpp"
+
+using namespace std;
+
+const char* scheduler_name(scheduler_kind kind) {
+    switch (kind) {
+        case scheduler_kind::ROUND_ROBIN: return "rr";
+        case scheduler_kind::PRIORITY:    return "priority";
+        default:                          return "fcfs";
+    }
+}
+
+bool parse_scheduler(string_view name, scheduler_kind& kind) {
+    if (name == "fcfs") kind = scheduler_kind::FCFS;
+    else if (name == "rr") kind = scheduler_kind::ROUND_ROBIN;
+    else if (name == "priority") kind = scheduler_kind::PRIORITY;
+    else return false;
+    return true;
+}
+
+event_engine::event_engine(simulator_context& _ctx, program_cache& _cache, const program_catalog& _catalog,
+                           const dispatch_table& _interrupts, event_config _config,
+                           log_sink& _exec_log, log_sink& _sys_log)
+    : ctx(_ctx), cache(_cache), catalog(_catalog), interrupts(_interrupts), config(_config),
+      exec_log(_exec_log), sys_log(_sys_log) {
+    if (config.quantum < 1) config.quantum = 1;
+}
+
+const event_engine::stats& event_engine::run(shared_ptr<const compiled_program> program, PCB init) {
+    PROFILE_SCOPE(profile_counter::SIMULATE);
+    procs.clear();
+    table.clear();
+    calendar = {};
+    ready.clear();
+    ready_by_priority = {};
+    device_free_at.assign(interrupts.size(), 0);
+    seq = 0;
+    now = 0;
+    running = NONE;
+    totals = {};
+
+    uint32_t pid = init.PID;
+    procs.resize(pid + 1);
+    procs[pid].program = move(program);
+    table.add(pid, init.PPID, init.program_name, init.size, init.partition_number, pcb_state::READY);
+    live = 1;
+    totals.processes = totals.max_live = 1;
+    make_ready(pid);
+    dispatch();
+
+    while (!calendar.empty()) {
+        event e = calendar.top();
+        calendar.pop();
+        now = e.time;
+        totals.events++;
+        if (e.kind == event_kind::CPU_DONE) {
+            cpu_done(e.pid, e.slice);
+        } else {
+            make_ready(e.pid);
+            snapshot("I/O complete", e.slice);
+            dispatch();
+        }
+    }
+    totals.end_time = now;
+    exec_log.flush();
+    sys_log.flush();
+    return totals;
+}
+
+// ===== CALENDAR AND READY QUEUE =====
+
+void event_engine::schedule(long long time, uint32_t pid, event_kind kind, int slice) {
+    calendar.push({time, seq++, pid, kind, slice});
+}
+
+void event_engine::make_ready(uint32_t pid) {
+    table.set_state(pid, pcb_state::READY);
+    if (config.scheduler == scheduler_kind::PRIORITY)
+        ready_by_priority.push({procs[pid].priority, seq++, pid});
+    else
+        ready.push_back(pid);
+}
+
+bool event_engine::ready_empty() const {
+    return config.scheduler == scheduler_kind::PRIORITY ? ready_by_priority.empty() : ready.empty();
+}
+
+uint32_t event_engine::pop_ready() {
+    uint32_t pid;
+    if (config.scheduler == scheduler_kind::PRIORITY) {
+        pid = ready_by_priority.top().pid;
+        ready_by_priority.pop();
+    } else {
+        pid = ready.front();
+        ready.pop_front();
+    }
+    return pid;
+}
+
+// ===== CPU =====
+
+void event_engine::dispatch() {
+    if (running != NONE || ready_empty()) return;
+    uint32_t pid = pop_ready();
+    process& p = procs[pid];
+    table.set_state(pid, pcb_state::RUNNING);
+    p.quantum_left = config.quantum;
+    running = pid;
+    totals.dispatches++;
+    log_slice(now, 0, pid, "scheduler called");
+    run_next(pid);
+}
+
+long long event_engine::cost_of(const process& p, const instruction& ins) const {
+    // Kernel entry plus IRET; vectors past the table cost the defaults
+    auto kernel = [&](int vector) -> long long {
+        if (!interrupts.contains(vector)) return isr_costs{}.entry() + isr_costs{}.iret;
+        const dispatch_table::entry& e = interrupts.at(vector);
+        return e.entry_cost + e.costs.iret;
+    };
+    switch (ins.op) {
+    case opcode::CPU:
+        return ins.value;
+    case opcode::SYSCALL:
+    case opcode::END_IO:
+        return kernel(ins.value);
+    case opcode::FORK:
+        return kernel(2) + ins.value;
+    case opcode::EXEC: {
+        const program_entry* e = catalog.find(p.program->names.name(ins.image));
+        if (!e) e = catalog.find(p.program->names.name(ins.program));
+        long long size = e ? e->size : 0;
+        return kernel(3) + ins.value + interrupts.load_time((unsigned)size) + 3 + 6;
+    }
+    default:
+        return 1;
+    }
+}
+
+// Starts (or resumes) the running process's next instruction
+void event_engine::run_next(uint32_t pid) {
+    process& p = procs[pid];
+    const compiled_program& prog = *p.program;
+
+    // Branch markers for the other side of a FORK, and unknown lines, take no time
+    while (!p.started && p.pc < prog.trace.code.size()) {
+        const instruction& ins = prog.trace.code[p.pc];
+        if ((ins.op == opcode::IF_CHILD && p.role == branch::PARENT) ||
+            (ins.op == opcode::IF_PARENT && p.role == branch::CHILD)) {
+            p.pc = prog.jump[p.pc];
+        } else if (ins.op == opcode::UNKNOWN) {
+            exec_log.write_int(now); exec_log.write(", 0, Unknown trace line: ");
+            exec_log.write(prog.trace.literals[ins.program]); exec_log.write('\n');
+            p.pc++;
+        } else {
+            break;
+        }
+    }
+
+    if (p.pc >= prog.trace.code.size()) {
+        exit_process(pid);
+        running = NONE;
+        dispatch();
+        return;
+    }
+
+    if (!p.started) {
+        p.remaining = cost_of(p, prog.trace.code[p.pc]);
+        p.started = true;
+    }
+    long long slice = p.remaining;
+    if (config.scheduler == scheduler_kind::ROUND_ROBIN) slice = min<long long>(slice, p.quantum_left);
+    schedule(now + slice, pid, event_kind::CPU_DONE, (int)slice);
+}
+
+void event_engine::cpu_done(uint32_t pid, int slice) {
+    process& p = procs[pid];
+    const instruction& ins = p.program->trace.code[p.pc];
+    PROFILE_SCOPE(opcode_counter(ins.op));
+    log_slice(now - slice, slice, pid, ins.op == opcode::CPU ? "CPU Burst" : opcode_name(ins.op));
+    p.remaining -= slice;
+    p.quantum_left -= slice;
+
+    if (p.remaining > 0) {   // quantum expired mid-instruction
+        if (ready.empty()) {
+            p.quantum_left = config.quantum;
+            run_next(pid);
+            return;
+        }
+        totals.preemptions++;
+        running = NONE;
+        make_ready(pid);
+        dispatch();
+        return;
+    }
+    p.started = false;
+    complete(pid);
+}
+
+// The instruction's CPU work is done; apply its effect
+void event_engine::complete(uint32_t pid) {
+    process& p = procs[pid];
+    const instruction ins = p.program->trace.code[p.pc];
+
+    switch (ins.op) {
+    case opcode::SYSCALL: {
+        p.pc++;
+        totals.io_requests++;
+        long long delay = 0, start = now;
+        if (interrupts.contains(ins.value) && interrupts.at(ins.value).has_device) {
+            delay = interrupts.at(ins.value).delay;
+            start = max(now, device_free_at[ins.value]);
+            device_free_at[ins.value] = start + delay;
+        }
+        exec_log.write_int(now); exec_log.write(", "); exec_log.write_int(start + delay - now);
+        exec_log.write(", PID "); exec_log.write_int(pid); exec_log.write(": waiting on device ");
+        exec_log.write_int(ins.value);
+        if (interrupts.contains(ins.value) && interrupts.at(ins.value).has_isr) {
+            exec_log.write(" (ISR "); exec_log.write(interrupts.at(ins.value).isr); exec_log.write(')');
+        }
+        exec_log.write('\n');
+        table.set_state(pid, pcb_state::BLOCKED);
+        running = NONE;
+        schedule(start + delay, pid, event_kind::IO_DONE, ins.value);
+        dispatch();
+        return;
+    }
+    case opcode::FORK:
+        p.pc++;
+        fork(pid, ins.value);
+        break;
+    case opcode::EXEC:
+        exec(pid, ins);
+        break;
+    case opcode::ENDIF:
+        p.role = branch::NONE;
+        p.pc++;
+        break;
+    default:
+        p.pc++;
+    }
+
+    process& q = procs[pid];   // fork may have grown the table
+    if (table.state(pid) != pcb_state::RUNNING) {
+        running = NONE;
+        dispatch();
+        return;
+    }
+
+    bool preempt = false;
+    if (config.scheduler == scheduler_kind::ROUND_ROBIN)
+        preempt = q.quantum_left <= 0 && !ready.empty();
+    else if (config.scheduler == scheduler_kind::PRIORITY)
+        preempt = !ready_by_priority.empty() && ready_by_priority.top().priority < q.priority;
+
+    if (preempt) {
+        totals.preemptions++;
+        running = NONE;
+        make_ready(pid);
+        dispatch();
+    } else {
+        if (q.quantum_left <= 0) q.quantum_left = config.quantum;   // nobody else to run
+        run_next(pid);
+    }
+}
+
+// ===== PROCESS LIFECYCLE =====
+
+void event_engine::fork(uint32_t pid, int val) {
+    procs[pid].role = branch::PARENT;
+
+    unsigned size = table.size(pid);
+    int pn = ctx.partitions.allocate(size, (int32_t)ctx.owner_names.intern(table.program(pid)));
+    if (pn < 0) {
+        totals.failed_forks++;
+        log_slice(now, 0, pid, "FORK failed (no memory)");
+        return;
+    }
+
+    uint32_t child = ctx.next_pid++;
+    table.add(child, (int)pid, table.program(pid), size, pn, pcb_state::READY);
+    if (child >= procs.size()) procs.resize(child + 1);
+    process& c = procs[child];
+    const process& p = procs[pid];
+    c.program = p.program;
+    c.pc = p.pc;
+    c.role = branch::CHILD;
+    c.priority = p.priority + 1;
+    live++;
+    totals.processes++;
+    totals.max_live = max(totals.max_live, live);
+    make_ready(child);
+    snapshot("FORK", val);
+}
+
+void event_engine::exec(uint32_t pid, const instruction& ins) {
+    process& p = procs[pid];
+    const string& name = p.program->names.name(ins.program);
+    const string& file = p.program->names.name(ins.image);
+
+    // Like execve(), a missing program fails and the old image keeps running
+    shared_ptr<const compiled_program> body = cache.get(file);
+    if (!body) {
+        log_slice(now, 0, pid, "EXEC failed (" + file + ".txt not found)");
+        p.pc++;
+        return;
+    }
+
+    const program_entry* entry = catalog.find(file);
+    if (!entry) entry = catalog.find(name);
+
+    free_memory(ctx, table, pid);
+    table.set_program(pid, name, entry ? entry->size : 0);
+    if (!allocate_memory(ctx, table, pid)) {
+        log_slice(now, 0, pid, "EXEC failed (no memory)");
+        exit_process(pid);
+        return;
+    }
+
+    p.program = move(body);
+    p.pc = 0;
+    p.role = branch::NONE;
+    snapshot("EXEC " + table.program(pid), ins.value);
+}
+
+void event_engine::exit_process(uint32_t pid) {
+    free_memory(ctx, table, pid);
+    table.set_state(pid, pcb_state::TERMINATED);
+    procs[pid].program.reset();
+    live--;
+    snapshot("exit", (int)pid);
+}
+
+// ===== LOGGING =====
+
+// "<start>, <duration>, PID <pid>: <what>"
+void event_engine::log_slice(long long start, long long duration, uint32_t pid, string_view what) {
+    if (!exec_log.enabled()) return;
+    exec_log.write_int(start); exec_log.write(", "); exec_log.write_int(duration);
+    exec_log.write(", PID "); exec_log.write_int(pid); exec_log.write(": ");
+    exec_log.write(what); exec_log.write('\n');
+}
+
+void event_engine::snapshot(string_view label, int val) {
+    if (sys_log.enabled()) table.write_snapshot(sys_log, config.status, now, label, val);
+}
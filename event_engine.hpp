@@ -0,0 +1,136 @@
+#ifndef EVENT_ENGINE_HPP_
+#define EVENT_ENGINE_HPP_
+
+#include <deque>
+#include <memory>
+#include <queue>
+
+#include "interrupts_101297993_101302793.hpp"
+#include "program_cache.hpp"
+
+// ====================== DISCRETE-EVENT ENGINE ======================
+
+enum class scheduler_kind : std::uint8_t {
+    FCFS,          // run until the process blocks or exits
+    ROUND_ROBIN,   // FCFS with a time quantum
+    PRIORITY       // lowest priority value first, preempting at instruction boundaries
+};
+
+const char* scheduler_name(scheduler_kind kind);
+bool parse_scheduler(std::string_view name, scheduler_kind& kind);   // "fcfs|rr|priority"
+
+struct event_config {
+    scheduler_kind scheduler = scheduler_kind::FCFS;
+    int quantum = 50;
+    status_mode status = status_mode::FULL;
+};
+
+// Simulates every process concurrently on one CPU, driven by an event
+// calendar (a binary heap ordered by time, then by insertion order so ties
+// are deterministic) instead of by walking the trace:
+//  - CPU bursts and kernel work occupy the CPU; round-robin slices them.
+//  - SYSCALL enters the kernel, then blocks the process on its device for
+//    the device_table delay. Each device serves requests one at a time, in
+//    arrival order; the process is ready again when its I/O completes.
+//    END_IO lines only cost the interrupt entry and IRET.
+//  - FORK makes the child ready alongside the parent (IF_CHILD/IF_PARENT
+//    pick the branch); EXEC replaces the image from the program_cache.
+// PCBs live in a pcb_table and the scheduler state in a parallel array, both
+// indexed by PID, so the tables stay flat with 100k+ processes. The status
+// log gets a snapshot at every FORK, EXEC, exit and I/O completion; use
+// status_mode::DELTA for large runs.
+class event_engine {
+public:
+    struct stats {
+        std::uint64_t events = 0;
+        std::uint64_t dispatches = 0;
+        std::uint64_t preemptions = 0;
+        std::uint64_t io_requests = 0;
+        std::uint64_t processes = 0;
+        std::uint64_t failed_forks = 0;
+        std::uint64_t max_live = 0;
+        long long end_time = 0;
+    };
+
+    event_engine(simulator_context& ctx, program_cache& cache, const program_catalog& catalog,
+                 const dispatch_table& interrupts, event_config config, log_sink& exec_log, log_sink& sys_log);
+
+    // Runs `program` as the image of `init` until no process is left
+    const stats& run(std::shared_ptr<const compiled_program> program, PCB init);
+
+private:
+    enum class branch : std::uint8_t { NONE, CHILD, PARENT };
+    enum class event_kind : std::uint8_t { CPU_DONE, IO_DONE };
+
+    // Scheduling state; the PCB itself is table row `pid`
+    struct process {
+        std::shared_ptr<const compiled_program> program;
+        std::size_t pc = 0;
+        long long remaining = 0;   // CPU time left in the current instruction
+        int quantum_left = 0;
+        int priority = 0;
+        branch role = branch::NONE;
+        bool started = false;      // the current instruction has been costed
+    };
+
+    struct event {
+        long long time;
+        std::uint64_t seq;
+        std::uint32_t pid;
+        event_kind kind;
+        int slice;   // CPU_DONE: time run; IO_DONE: device
+    };
+    struct later {
+        bool operator()(const event& a, const event& b) const {
+            return a.time != b.time ? a.time > b.time : a.seq > b.seq;
+        }
+    };
+
+    struct ready_entry {
+        int priority;
+        std::uint64_t seq;
+        std::uint32_t pid;
+        bool operator>(const ready_entry& o) const {
+            return priority != o.priority ? priority > o.priority : seq > o.seq;
+        }
+    };
+
+    void schedule(long long time, std::uint32_t pid, event_kind kind, int slice = 0);
+    void make_ready(std::uint32_t pid);
+    bool ready_empty() const;
+    std::uint32_t pop_ready();
+    void dispatch();
+    void run_next(std::uint32_t pid);
+    void cpu_done(std::uint32_t pid, int slice);
+    void complete(std::uint32_t pid);
+    void fork(std::uint32_t pid, int val);
+    void exec(std::uint32_t pid, const instruction& ins);
+    void exit_process(std::uint32_t pid);
+    long long cost_of(const process& p, const instruction& ins) const;
+    void log_slice(long long start, long long duration, std::uint32_t pid, std::string_view what);
+    void snapshot(std::string_view label, int val);
+
+    simulator_context& ctx;
+    program_cache& cache;
+    const program_catalog& catalog;
+    const dispatch_table& interrupts;
+    event_config config;
+    log_sink& exec_log;
+    log_sink& sys_log;
+
+    pcb_table table;
+    std::vector<process> procs;   // procs[pid]
+    std::priority_queue<event, std::vector<event>, later> calendar;
+    std::deque<std::uint32_t> ready;   // FCFS / ROUND_ROBIN
+    std::priority_queue<ready_entry, std::vector<ready_entry>, std::greater<ready_entry>> ready_by_priority;
+    std::vector<long long> device_free_at;
+    std::uint64_t seq = 0;
+    long long now = 0;
+    std::uint32_t running = NONE;
+    std::uint64_t live = 0;
+    stats totals;
+
+    static constexpr std::uint32_t NONE = UINT32_MAX;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#include "fixed_timings.hpp"
+#include "text_scan.hpp"
+#include "trace_reader.hpp"
+#include <stdexcept>
+#include <sys/stat.h>
+
+using namespace std;
+
+// ===== LOOKUP =====
+
+const timing_rule* fixed_timings::match(timing_trigger trigger, int state, string_view program, int value) const {
+    for (const timing_rule& r : rules)
+        if (r.trigger == trigger && r.value == value && (r.state < 0 || r.state == state) && r.program == program)
+            return &r;
+    return nullptr;
+}
+
+unsigned fixed_timings::size_of(int state, string_view program) const {
+    for (const size_entry& e : sizes)
+        if ((e.state < 0 || e.state == state) && e.program == program) return e.size;
+    return 0;
+}
+
+bool fixed_timings::holds(int state) const {
+    for (int h : held)
+        if (h < 0 || h == state) return true;
+    return false;
+}
+
+// ===== PARSING =====
+
+static string_view trim(string_view s) {
+    size_t from = s.find_first_not_of(" \t\r");
+    if (from == string_view::npos) return {};
+    return s.substr(from, s.find_last_not_of(" \t\r") - from + 1);
+}
+
+// Comma separated fields, trimmed
+static vector<string_view> fields_of(string_view text) {
+    vector<string_view> fields;
+    for (size_t from = 0;;) {
+        size_t comma = text.find(',', from);
+        fields.push_back(trim(text.substr(from, comma == string_view::npos ? string_view::npos : comma - from)));
+        if (comma == string_view::npos) return fields;
+        from = comma + 1;
+    }
+}
+
+namespace {
+
+struct timings_parser {
+    const string& path;
+    line_reader& reader;
+    vector<string>& states;
+
+    runtime_error fail(const string& why) const {
+        return runtime_error(path + ":" + to_string(reader.line_number()) + ": " + why);
+    }
+
+    int number(string_view field) const {
+        int v;
+        if (!parse_int_exact(field, v)) throw fail("bad number '" + string(field) + "'");
+        return v;
+    }
+
+    int state_index(string_view name) {
+        if (name.empty()) throw fail("empty state name");
+        for (size_t i = 0; i < states.size(); i++)
+            if (states[i] == name) return (int)i;
+        states.emplace_back(name);
+        return (int)states.size() - 1;
+    }
+
+    // "PID, PPID, NAME, MB, PARTITION"
+    void pcb(string_view args, timing_action& a) const {
+        vector<string_view> f = fields_of(args);
+        if (f.size() != 5 || f[2].empty()) throw fail("expected 'PID, PPID, NAME, MB, PARTITION'");
+        a.numbers = {number(f[0]), number(f[1]), number(f[3]), number(f[4])};
+        if (a.numbers[0] < 0 || a.numbers[2] < 0) throw fail("negative PID or size");
+        a.text = f[2];
+    }
+
+    timing_action action(string_view text) {
+        size_t space = text.find_first_of(" \t");
+        string_view word = text.substr(0, space);
+        string_view args = space == string_view::npos ? string_view() : trim(text.substr(space));
+        auto want_args = [&](bool wanted) {
+            if (args.empty() == wanted) throw fail("'" + string(word) + (wanted ? "' needs a value" : "' takes no value"));
+        };
+        timing_action a{timing_action::STATE, {}, {}};
+        if (word == "allocate" || word == "clear") {
+            want_args(false);
+            a.kind = word == "allocate" ? timing_action::ALLOCATE : timing_action::CLEAR;
+            return a;
+        }
+        want_args(true);
+        if (word == "state") {
+            a.numbers = {state_index(args)};
+        } else if (word == "time" || word == "advance" || word == "partition") {
+            a.kind = word == "time" ? timing_action::TIME : word == "advance" ? timing_action::ADVANCE : timing_action::PARTITION;
+            a.numbers = {number(args)};
+        } else if (word == "times") {
+            a.kind = timing_action::TIMES;
+            for (string_view f : fields_of(args)) a.numbers.push_back(number(f));
+        } else if (word == "event") {
+            size_t comma = args.find(',');
+            if (comma == string_view::npos || trim(args.substr(comma + 1)).empty()) throw fail("expected 'event D, TEXT'");
+            a.kind = timing_action::EVENT;
+            a.numbers = {number(args.substr(0, comma))};
+            a.text = trim(args.substr(comma + 1));
+        } else if (word == "snapshot") {
+            size_t comma = args.rfind(',');
+            if (comma == string_view::npos || trim(args.substr(0, comma)).empty())
+                throw fail("expected 'snapshot LABEL, VALUE'");
+            a.kind = timing_action::SNAPSHOT;
+            a.numbers = {number(args.substr(comma + 1))};
+            a.text = trim(args.substr(0, comma));
+        } else if (word == "program") {
+            vector<string_view> f = fields_of(args);
+            if (f.size() != 2 || f[0].empty()) throw fail("expected 'program NAME, MB'");
+            a.kind = timing_action::PROGRAM;
+            a.numbers = {number(f[1])};
+            a.text = f[0];
+        } else if (word == "run" || word == "wait") {
+            a.kind = word == "run" ? timing_action::RUN : timing_action::WAIT;
+            pcb(args, a);
+        } else {
+            throw fail("unknown action '" + string(word) + "'");
+        }
+        return a;
+    }
+
+    void actions(string_view text, timing_rule& rule) {
+        for (size_t from = 0, semi = 0; semi != string_view::npos; from = semi + 1) {
+            semi = text.find(';', from);
+            string_view item = trim(text.substr(from, semi == string_view::npos ? string_view::npos : semi - from));
+            if (!item.empty()) rule.actions.push_back(action(item));
+        }
+    }
+};
+
+}   // namespace
+
+fixed_timings load_fixed_timings(const string& path) {
+    fixed_timings timings;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return timings;
+
+    auto reader = line_reader::open(path);
+    timings_parser parser{path, *reader, timings.states};
+    uint64_t hash = FNV1A_SEED;
+    size_t last = SIZE_MAX;   // rule that continuation lines extend
+    string_view raw;
+    while (reader->next(raw)) {
+        string_view line = raw.substr(0, raw.find('#'));
+        bool continued = !line.empty() && (line[0] == ' ' || line[0] == '\t');
+        line = trim(line);
+        if (line.empty()) continue;
+        hash = fnv1a("\n", fnv1a(line, hash));
+
+        if (continued) {
+            if (last == SIZE_MAX) throw parser.fail("indented line does not continue a rule");
+            parser.actions(line, timings.rules[last]);
+            continue;
+        }
+        last = SIZE_MAX;
+
+        int state = -1;
+        if (line[0] == '[') {
+            size_t close = line.find(']');
+            if (close == string_view::npos) throw parser.fail("missing ']'");
+            state = parser.state_index(trim(line.substr(1, close - 1)));
+            line = trim(line.substr(close + 1));
+        }
+        size_t colon = line.find(':');
+        string_view head = trim(line.substr(0, colon));
+        size_t space = head.find_first_of(" \t");
+        string_view word = head.substr(0, space);
+        vector<string_view> args = fields_of(space == string_view::npos ? string_view() : trim(head.substr(space)));
+
+        if (word == "hold" || word == "size") {
+            if (colon != string_view::npos) throw parser.fail("'" + string(word) + "' takes no actions");
+            if (word == "hold") {
+                if (args.size() != 1 || !args[0].empty()) throw parser.fail("'hold' takes no value");
+                timings.held.push_back(state);
+            } else {
+                int size;
+                if (args.size() != 2 || args[0].empty()) throw parser.fail("expected 'size PROGRAM, MB'");
+                if ((size = parser.number(args[1])) < 0) throw parser.fail("negative program size");
+                timings.sizes.push_back({state, string(args[0]), (unsigned)size});
+            }
+            continue;
+        }
+
+        timing_trigger trigger;
+        if (word == "FORK") trigger = timing_trigger::FORK;
+        else if (word == "EXEC") trigger = timing_trigger::EXEC;
+        else if (word == "IDLE") trigger = timing_trigger::IDLE;
+        else throw parser.fail("expected FORK, EXEC, IDLE, size or hold, not '" + string(word) + "'");
+        if (args.size() != 2 || args[0].empty()) throw parser.fail("expected '" + string(word) + " PROGRAM, VALUE'");
+        if (colon == string_view::npos) throw parser.fail("expected ': ACTIONS' after the trigger");
+
+        timings.rules.push_back({state, trigger, string(args[0]), parser.number(args[1]), {}});
+        timings.idle_rules |= trigger == timing_trigger::IDLE;
+        last = timings.rules.size() - 1;
+        parser.actions(line.substr(colon + 1), timings.rules[last]);
+    }
+    timings.hash = hash;
+    return timings;
+}
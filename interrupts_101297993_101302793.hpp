@@ -5,6 +5,7 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <deque>
 #include <random>
 #include <utility>
 #include <sstream>
@@ -12,6 +13,15 @@
 #include <algorithm>
 #include <stdio.h>
 
+#include "trace_compiler.hpp"
+#include "trace_reader.hpp"
+#include "log_writer.hpp"
+#include "partition_manager.hpp"
+#include "program_catalog.hpp"
+#include "pcb_table.hpp"
+#include "dispatch_table.hpp"
+#include "fixed_timings.hpp"
+
 using namespace std;
 
 #define ADDR_BASE   0
@@ -19,17 +29,6 @@ using namespace std;
 
 // ====================== STRUCT DEFINITIONS ======================
 
-struct memory_partition_t {
-    const unsigned int partition_number;
-    const unsigned int size;
-    std::string code;
-
-    memory_partition_t(unsigned int _pn, unsigned int _s, std::string _c)
-        : partition_number(_pn), size(_s), code(_c) {}
-};
-
-extern memory_partition_t memory[]; // defined in .cpp
-
 struct PCB {
     unsigned int PID;
     int PPID;
@@ -40,41 +39,143 @@ struct PCB {
     PCB(unsigned int _pid, int _ppid, std::string _pn, unsigned int _size, int _part_num);
 };
 
+struct checkpoint;
+class checkpoint_schedule;
+
 struct external_file {
     std::string program_name;
     unsigned int size;
 };
 
+// Everything one simulation mutates. Each run owns its own context, so
+// several traces can be simulated at once on different threads.
+struct simulator_context {
+    partition_manager partitions;
+    string_pool owner_names;   // partition owners are ids into this pool
+    unsigned int next_pid = 1;
+    std::deque<PCB> wait_queue;   // FIFO: dequeued from the front in O(1)
+
+    explicit simulator_context(std::vector<unsigned> partition_sizes = partition_manager::default_sizes(),
+                               placement_policy policy = placement_policy::LEGACY);
+};
+
 // ===================== FUNCTION DECLARATIONS =====================
 
 // Memory management
-bool allocate_memory(PCB* current);
-void free_memory(PCB* process);
+bool allocate_memory(simulator_context& ctx, PCB* current);
+void free_memory(simulator_context& ctx, PCB* process);
+bool allocate_memory(simulator_context& ctx, pcb_table& table, unsigned pid);
+void free_memory(simulator_context& ctx, pcb_table& table, unsigned pid);
 
 // String and parsing helpers
 std::vector<std::string> split_delim(std::string input, std::string delim);
-std::tuple<std::vector<std::string>, std::vector<int>, std::vector<external_file>>
+std::tuple<std::vector<std::string>, std::vector<int>, program_catalog>
 parse_args(int argc, char** argv);
+// parse_args' table reading; throws runtime_error where parse_args exits
+std::tuple<std::vector<std::string>, std::vector<int>, program_catalog>
+load_table_files(const char* vector_path, const char* device_path, const char* external_path);
 std::tuple<std::string, int, std::string> parse_trace(std::string trace);
 
 // Interrupt and output handling
 std::pair<std::string, int> intr_boilerplate(int current_time, int intr_num,
-                                            int context_save_time, std::vector<std::string> vectors);
+                                            int context_save_time, const std::vector<std::string>& vectors);
 void write_output(std::string execution, const char* filename);
+
+// Log-sink writers shared by the compiled simulators
+void write_event(log_sink& log, int time, long long duration, std::string_view event);
+void write_snapshot(log_sink& log, int time, std::string_view label, int val,
+                    const PCB& current, const std::deque<PCB>& wait_queue);
+// Same table from a flat list: rows[0] is running, the rest are waiting
+void write_snapshot(log_sink& log, int time, std::string_view label, int val,
+                    const PCB* rows, std::size_t count);
 void print_external_files(std::vector<external_file> files);
 
 // PCB and file helpers
 std::string print_PCB(PCB current, std::vector<PCB> _PCB);
-unsigned int get_size(std::string name, std::vector<external_file> external_files);
+unsigned int get_size(std::string name, std::vector<external_file> external_files);   // linear scan
+unsigned int get_size(std::string_view name, const program_catalog& catalog);
 
 // Simulation entry point
 std::tuple<std::string, std::string, int>
-simulate_trace(std::vector<std::string> trace_file,
+simulate_trace(simulator_context& ctx,
+               const std::vector<std::string>& trace_file,
                int time,
-               std::vector<std::string> vectors,
-               std::vector<int> delays,
-               std::vector<external_file> external_files,
-               PCB current,
-               std::vector<PCB> wait_queue);
+               const std::vector<std::string>& vectors,
+               const std::vector<int>& delays,
+               const program_catalog& catalog,
+               PCB current);
+
+// Same simulation over a pre-compiled trace; output is identical to
+// simulate_trace given the fixed timings in input_files/fixed_timings.txt
+std::tuple<std::string, std::string, int>
+simulate_compiled(simulator_context& ctx,
+                  const compiled_trace& trace,
+                  const string_pool& names,
+                  int time,
+                  const std::vector<std::string>& vectors,
+                  const std::vector<int>& delays,
+                  const program_catalog& catalog,
+                  PCB current,
+                  const fixed_timings* timings = nullptr);
+
+// Compiled-trace simulator. Takes one instruction at a time so a trace can be
+// fed straight from the compiler; output goes to the two log sinks. The
+// processes live in a pcb_table, the wait queue holds their PIDs, and ctx's
+// wait queue is moved into both. With status_mode::DELTA each snapshot
+// lists only the rows that changed.
+class trace_simulator {
+public:
+    trace_simulator(simulator_context& ctx, const string_pool& names, const dispatch_table& dispatch,
+                    const program_catalog& catalog, PCB current, int time,
+                    log_sink& exec_log, log_sink& sys_log, const ::fixed_timings* timings = nullptr,
+                    status_mode status = status_mode::FULL);
+
+    // `literal` is the raw line, only used for UNKNOWN instructions
+    void step(const instruction& ins, std::string_view literal = {});
+    int time() const { return t; }
+    unsigned failed_forks() const { return fork_failures; }   // FORKs with no free partition
+    // True once a fixed-timings rule has fired; from then on the time does
+    // not follow the cost model
+    bool fixed_timings() const { return pinned; }
+
+    // Copies the whole simulation state (including ctx's partitions and PID
+    // counter) out to / back in from a checkpoint. restore() throws
+    // std::runtime_error when the checkpoint was taken with other costs,
+    // tables, program sizes, fixed timings or status mode than this
+    // simulator's.
+    void save(checkpoint& state) const;
+    void restore(const checkpoint& state);
+
+    log_sink& exec_log;
+    log_sink& sys_log;
+
+private:
+    void snapshot(std::string_view label, int val);
+    // Runs the fixed-timings rule `trigger` matches, if any
+    void fire(timing_trigger trigger, std::string_view program, int value);
+
+    simulator_context& ctx;
+    const string_pool& names;
+    const dispatch_table& dispatch;
+    const program_catalog& catalog;
+
+    status_mode status;
+    pcb_table table;
+    unsigned current;                   // PID of the running process
+    std::deque<std::uint32_t> waiting;  // PIDs, front first
+    int t;
+    unsigned fork_failures = 0;
+
+    const ::fixed_timings* timings;   // nullptr when there are none
+    int timing_state = ::fixed_timings::DEFAULT_STATE;
+    std::vector<std::uint32_t> fired;   // per rule
+    bool pinned = false;
+};
+
+// Reads, compiles and simulates line by line. Memory use does not grow with
+// the trace length; the sinks are flushed before returning. Checkpoints are
+// written between lines when `checkpoints` says one is due.
+int simulate_stream(line_reader& reader, string_pool& names, trace_simulator& sim,
+                    checkpoint_schedule* checkpoints = nullptr);
 
 #endif
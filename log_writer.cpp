@@ -0,0 +1,110 @@
+#include "log_writer.hpp"
+#include "profile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+log_sink::log_sink(sink_kind _kind, int _fd, bool _owns_fd, char _tag)
+    : kind(_kind), fd(_fd), owns_fd(_owns_fd), tag(_tag) {
+    if (kind != sink_kind::DISCARD) {
+        capacity = DEFAULT_CAPACITY;
+        buffer.reset(new char[capacity]);
+    }
+}
+
+log_sink log_sink::discard() { return log_sink(sink_kind::DISCARD); }
+log_sink log_sink::memory() { return log_sink(sink_kind::MEMORY); }
+log_sink log_sink::to_fd(int fd) { return log_sink(sink_kind::FD, fd, false); }
+
+log_sink log_sink::to_frames(int fd, char tag) { return log_sink(sink_kind::FRAMED, fd, false, tag); }
+
+log_sink log_sink::to_file(const string& path) {
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw runtime_error("cannot open " + path + " for writing");
+    return log_sink(sink_kind::FD, fd, true);
+}
+
+log_sink::log_sink(log_sink&& other) noexcept
+    : kind(other.kind), fd(other.fd), owns_fd(other.owns_fd), tag(other.tag), buffer(move(other.buffer)),
+      capacity(other.capacity), len(other.len), flushed(other.flushed), stored(move(other.stored)) {
+    other.kind = sink_kind::DISCARD;
+    other.owns_fd = false;
+    other.capacity = other.len = 0;
+}
+
+log_sink& log_sink::operator=(log_sink&& other) noexcept {
+    if (this != &other) {
+        release();
+        kind = other.kind;
+        fd = other.fd;
+        owns_fd = other.owns_fd;
+        tag = other.tag;
+        buffer = move(other.buffer);
+        capacity = other.capacity;
+        len = other.len;
+        flushed = other.flushed;
+        stored = move(other.stored);
+        other.kind = sink_kind::DISCARD;
+        other.owns_fd = false;
+        other.capacity = other.len = 0;
+    }
+    return *this;
+}
+
+log_sink::~log_sink() { release(); }
+
+// Destructors can't report a failed write; callers that care flush() first
+void log_sink::release() noexcept {
+    try { flush(); } catch (const exception&) {}
+    if (owns_fd) close(fd);
+    owns_fd = false;
+}
+
+static void write_all(int fd, const char* p, size_t left) {
+    while (left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw runtime_error("log write failed");
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+}
+
+void log_sink::write_frame(int fd, char tag, string_view payload) {
+    do {   // payloads over 4 GB become several frames
+        size_t n = min<size_t>(payload.size(), UINT32_MAX);
+        char header[5] = {tag, (char)n, (char)(n >> 8), (char)(n >> 16), (char)(n >> 24)};
+        write_all(fd, header, sizeof header);
+        write_all(fd, payload.data(), n);
+        payload.remove_prefix(n);
+    } while (!payload.empty());
+}
+
+void log_sink::write_through(string_view s) {
+    if (kind == sink_kind::MEMORY) stored.append(s);
+    else if (kind == sink_kind::FD) write_all(fd, s.data(), s.size());
+    else if (kind == sink_kind::FRAMED) write_frame(fd, tag, s);
+    flushed += s.size();
+}
+
+void log_sink::flush() {
+    if (len == 0) return;
+    PROFILE_SCOPE(profile_counter::WRITE);
+    size_t n = len;
+    len = 0;
+    write_through(string_view(buffer.get(), n));
+}
+
+string log_sink::take() {
+    flush();
+    string out;
+    out.swap(stored);
+    return out;
+}
@@ -0,0 +1,95 @@
+#ifndef LOG_WRITER_HPP_
+#define LOG_WRITER_HPP_
+
+#include <charconv>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// ========================= LOG SINK =========================
+
+// Buffered writer for the execution / system status logs. Text is formatted
+// straight into one preallocated buffer (numbers through to_chars) that is
+// flushed to a file descriptor, to an in-memory string, or dropped entirely
+// for timing runs. Move-only; flushes on destruction.
+class log_sink {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+    static log_sink discard();
+    static log_sink memory();
+    static log_sink to_fd(int fd);                  // caller keeps the fd
+    static log_sink to_file(const std::string& path);   // throws std::runtime_error
+    // Each flush becomes one frame on `fd` (see write_frame); the caller keeps the fd
+    static log_sink to_frames(int fd, char tag);
+
+    // One frame: a tag byte, a 32-bit little-endian length, then the bytes.
+    // Throws std::runtime_error if the fd can't be written.
+    static void write_frame(int fd, char tag, std::string_view payload);
+
+    log_sink(log_sink&& other) noexcept;
+    log_sink& operator=(log_sink&& other) noexcept;
+    log_sink(const log_sink&) = delete;
+    log_sink& operator=(const log_sink&) = delete;
+    ~log_sink();
+
+    bool enabled() const { return kind != sink_kind::DISCARD; }
+    std::size_t bytes() const { return flushed + len; }
+
+    void write(std::string_view s) {
+        if (!enabled()) return;
+        if (len + s.size() > capacity) { flush(); if (s.size() > capacity) { write_through(s); return; } }
+        std::memcpy(buffer.get() + len, s.data(), s.size());
+        len += s.size();
+    }
+    void write(char c) {
+        if (!enabled()) return;
+        if (len == capacity) flush();
+        buffer[len++] = c;
+    }
+    void write_int(long long v) {
+        if (!enabled()) return;
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof tmp, v);
+        write(std::string_view(tmp, res.ptr - tmp));
+    }
+
+    // setw()-style padding; text longer than `width` is never truncated
+    void write_padded(std::string_view s, int width, bool left_align) {
+        int fill = width - (int)s.size();
+        if (!left_align) pad(fill);
+        write(s);
+        if (left_align) pad(fill);
+    }
+    void write_padded_int(long long v, int width, bool left_align) {
+        char tmp[24];
+        auto res = std::to_chars(tmp, tmp + sizeof tmp, v);
+        write_padded(std::string_view(tmp, res.ptr - tmp), width, left_align);
+    }
+
+    void flush();
+
+    // Memory sinks only: everything written so far, leaving the sink empty
+    std::string take();
+
+private:
+    enum class sink_kind { DISCARD, MEMORY, FD, FRAMED };
+
+    explicit log_sink(sink_kind kind, int fd = -1, bool owns_fd = false, char tag = 0);
+    void pad(int n) { for (; n > 0; n--) write(' '); }
+    void write_through(std::string_view s);
+    void release() noexcept;
+
+    sink_kind kind;
+    int fd;
+    bool owns_fd;
+    char tag;   // FRAMED sinks
+    std::unique_ptr<char[]> buffer;
+    std::size_t capacity = 0;
+    std::size_t len = 0;
+    std::size_t flushed = 0;
+    std::string stored;   // MEMORY sinks
+};
+
+#endif
@@ -1,14 +1,191 @@
-#include "interrupts_101297993_101302793.hpp"
+#include "sim_runner.hpp"
+#include "sim_server.hpp"
+#include "sim_sweep.hpp"
+#include "checkpoint.hpp"
+#include "thread_pool.hpp"
+#include "profile.hpp"
+#include "text_scan.hpp"
 #include <iostream>
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <fnmatch.h>
+#include <glob.h>
 using namespace std;
 namespace fs = std::filesystem;
 
-// 🔹 Declare the reset function (implemented in interrupts cpp)
-extern void reset_memory();
+// A directory means every trace*.txt inside it; anything else is a glob
+static vector<string> collect_traces(const string& pattern) {
+    vector<string> traces;
+    if (fs::is_directory(pattern)) {
+        for (const auto& entry : fs::directory_iterator(pattern)) {
+            string name = entry.path().filename().string();
+            if (entry.is_regular_file() && fnmatch("trace*.txt", name.c_str(), 0) == 0)
+                traces.push_back(entry.path().string());
+        }
+    } else {
+        glob_t matches;
+        if (glob(pattern.c_str(), 0, nullptr, &matches) == 0)
+            for (size_t i = 0; i < matches.gl_pathc; i++) traces.push_back(matches.gl_pathv[i]);
+        globfree(&matches);
+    }
+    sort(traces.begin(), traces.end());
+    return traces;
+}
+
+// trace_3.txt -> "3", anything else keeps its stem
+static string output_suffix(const string& tracePath) {
+    string stem = fs::path(tracePath).stem().string();
+    return stem.rfind("trace_", 0) == 0 ? stem.substr(6) : stem;
+}
+
+// sim [options] --batch <dir|glob> [--jobs N] [--input DIR] [--out DIR]
+static int run_batch(const vector<string>& args, const sim_options& options) {
+    string pattern, inputDir = "input_files", outputDir = "output_files";
+    unsigned jobs = 0;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--batch" && i + 1 < args.size()) pattern = args[++i];
+        else if (args[i] == "--jobs" && i + 1 < args.size()) {
+            int n;
+            if (!parse_int_exact(args[++i], n) || n <= 0) {
+                cerr << "Invalid batch option: --jobs " << args[i] << " (expected a positive thread count)" << endl;
+                return 1;
+            }
+            jobs = (unsigned)n;
+        }
+        else if (args[i] == "--input" && i + 1 < args.size()) inputDir = args[++i];
+        else if (args[i] == "--out" && i + 1 < args.size()) outputDir = args[++i];
+        else { cerr << "Unknown batch option: " << args[i] << endl; return 1; }
+    }
+
+    vector<string> traces = collect_traces(pattern);
+    if (traces.empty()) {
+        cerr << "No traces match " << pattern << endl;
+        return 1;
+    }
+    // Logs are named by suffix alone; two traces sharing one would write the
+    // same files from two threads
+    if (options.logging) {
+        map<string, string> bySuffix;
+        for (const string& trace : traces) {
+            auto [it, fresh] = bySuffix.emplace(output_suffix(trace), trace);
+            if (!fresh) {
+                cerr << it->second << " and " << trace << " would both write execution_" << it->first
+                     << ".txt; run them as separate batches or rename one\n";
+                return 1;
+            }
+        }
+    }
+    if (options.logging && !fs::exists(outputDir)) fs::create_directories(outputDir);
+
+    const sim_tables tables = load_tables(traces[0], inputDir, options.costs);
+    program_cache cache(inputDir);   // shared by every trace in the batch
+    vector<string> errors(traces.size());
+    vector<char> ok(traces.size(), 0);
+    {
+        thread_pool pool(jobs);
+        cout << "Running " << traces.size() << " traces on " << pool.size() << " threads\n";
+        for (size_t i = 0; i < traces.size(); i++) {
+            pool.submit([&, i] {
+                string suffix = output_suffix(traces[i]);
+                ok[i] = run_simulation(traces[i], tables,
+                                       outputDir + "/execution_" + suffix + ".txt",
+                                       outputDir + "/system_status_" + suffix + ".txt",
+                                       options, cache, errors[i]);
+            });
+        }
+        pool.wait();
+    }
+
+    // Report in trace order so the console output is deterministic too
+    int failed = 0;
+    for (size_t i = 0; i < traces.size(); i++) {
+        if (!ok[i]) { cerr << errors[i] << endl; failed++; }
+    }
+    cout << traces.size() - failed << "/" << traces.size() << " simulations complete.\n";
+    return failed == 0 ? 0 : 1;
+}
+
+// Writes <prefix>.json/.csv/.trace.json when --profile was given
+static int finish_profile(const string& prefix, int status) {
+    if (prefix.empty()) return status;
+    try {
+        profile_write_reports(prefix);
+        cout << "Profile written to " << prefix << ".{json,csv,trace.json}\n";
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return status;
+}
+
+int main(int argc, char** argv) {
+    string inputDir = "input_files";
+    string outputDir = "output_files";
+
+    // Options shared by every mode are listed at parse_sim_options; --profile PREFIX
+    // applies to the whole process
+    sim_options options;
+    vector<string> args;
+    string profilePrefix, error;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--profile" && i + 1 < argc) {
+            if (!profile_enabled()) {
+                cerr << "--profile needs a build with SIM_PROFILE (cmake -DSIM_PROFILE=ON)\n";
+                return 1;
+            }
+            profilePrefix = argv[++i];
+            profile_record_events(true);
+        } else args.push_back(arg);
+    }
+    if (!parse_sim_options(args, options, error)) {
+        cerr << error << endl;
+        return 1;
+    }
+
+    // sim [options] --serve <socket> [--input DIR] [--jobs N]
+    if (!args.empty() && args[0] == "--serve") return finish_profile(profilePrefix, run_server(args, options));
+
+    if (options.checkpointing() &&
+        (args.empty() || args[0] == "--batch" || args[0] == "--sweep" || options.exec_programs || options.event_driven)) {
+        cerr << "Checkpoints need a single trace on the default engine (sim [options] <trace>)\n";
+        return 1;
+    }
+
+    if (!args.empty() && args[0] == "--batch") return finish_profile(profilePrefix, run_batch(args, options));
+
+    // sim [options] --sweep <trace> [--vary-save V] [--vary-load-rate V] [--vary-delays V] [--vary-partitions S]
+    if (!args.empty() && args[0] == "--sweep") return finish_profile(profilePrefix, run_sweep_command(args, options));
+
+    if (!fs::exists(outputDir))
+        fs::create_directory(outputDir);
+
+    // sim [options] <trace|-> [execution_out] [status_out]
+    if (!args.empty()) {
+        string execOut = args.size() > 1 ? args[1] : outputDir + "/execution.txt";
+        string sysOut = args.size() > 2 ? args[2] : outputDir + "/system_status.txt";
+        program_cache cache(inputDir);
+        if (!options.resume_from.empty()) {
+            try {
+                options.resume_state = make_shared<const checkpoint>(read_checkpoint(options.resume_from));
+                const checkpoint& state = *options.resume_state;
+                cout << "Resuming at line " << state.line << ", time " << state.time
+                     << "; the logs continue the full run's from byte " << state.exec_bytes
+                     << " (execution) and " << state.sys_bytes << " (status)\n";
+            } catch (const exception& e) {
+                cerr << "Error: " << e.what() << endl;
+                return 1;
+            }
+        }
+        if (!run_simulation(args[0], load_tables(args[0], inputDir, options.costs), execOut, sysOut, options, cache, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        if (options.logging) cout << "Saved logs:\n  " << execOut << "\n  " << sysOut << "\n";
+        return finish_profile(profilePrefix, 0);
+    }
 
-int main() {
     vector<string> traceFiles = {
         "input_files/trace_1.txt",
         "input_files/trace_2.txt",
@@ -17,13 +194,8 @@ int main() {
         "input_files/trace_5.txt"
     };
 
-    string inputDir = "input_files";
-    string outputDir = "output_files";
-
-    if (!fs::exists(outputDir))
-        fs::create_directory(outputDir);
-
     int simIndex = 1;
+    program_cache cache(inputDir);
 
     for (const auto& tracePath : traceFiles) {
         if (!fs::exists(tracePath)) {
@@ -34,62 +206,19 @@ int main() {
         cout << "\n=== Running Simulation " << simIndex
              << " (" << tracePath << ") ===\n";
 
-        // 🔹 Reset memory before each simulation
-        reset_memory();
-
-        // Define configuration files
-        string vecFile = inputDir + "/vector_table.txt";
-        string devFile = inputDir + "/device_table.txt";
-        string extFile = inputDir + "/external_files.txt";
-
-        // Proper C++ way to simulate argv array
-        std::vector<char*> argvVec;
-        argvVec.push_back((char*)"sim");
-        argvVec.push_back((char*)tracePath.c_str());
-        argvVec.push_back((char*)vecFile.c_str());
-        argvVec.push_back((char*)devFile.c_str());
-        argvVec.push_back((char*)extFile.c_str());
-
-        // Parse configuration files
-        auto [vectors, delays, external_files] =
-            parse_args(static_cast<int>(argvVec.size()), argvVec.data());
-
-        // Read trace file
-        ifstream traceInput(tracePath);
-        if (!traceInput.is_open()) {
-            cerr << "Error: could not open " << tracePath << endl;
-            continue;
-        }
-
-        PCB current(0, -1, "init", 1, -1);
-        if (!allocate_memory(&current)) {
-            cerr << "ERROR! Memory allocation failed!\n";
-            continue;
-        }
-
-        vector<PCB> wait_queue;
-        vector<string> trace_lines;
-        string line;
-        while (getline(traceInput, line)) {
-            if (!line.empty()) trace_lines.push_back(line);
-        }
-        traceInput.close();
-
-        //  Run the simulation
-        auto [execution, system_status, _] =
-            simulate_trace(trace_lines, 0, vectors, delays, external_files, current, wait_queue);
-
-        // --- Save output files for each trace run ---
+        // --- Output files for each trace run ---
         string execOut = outputDir + "/execution_" + to_string(simIndex) + ".txt";
         string sysOut = outputDir + "/system_status_" + to_string(simIndex) + ".txt";
 
-        write_output(execution, execOut.c_str());
-        write_output(system_status, sysOut.c_str());
+        if (!run_simulation(tracePath, load_tables(tracePath, inputDir, options.costs), execOut, sysOut, options, cache, error)) {
+            cerr << error << endl;
+            continue;
+        }
 
         cout << "Saved logs:\n  " << execOut << "\n  " << sysOut << "\n";
         simIndex++;
     }
 
     cout << "\n All simulations complete. Check output_files/ for results.\n";
-    return 0;
+    return finish_profile(profilePrefix, 0);
 }
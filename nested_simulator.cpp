@@ -0,0 +1,188 @@
+#include "nested_simulator.hpp"
+#include "profile.hpp"
+#include <stdexcept>
+
+using namespace std;
+
+nested_simulator::nested_simulator(simulator_context& _ctx, program_cache& _cache,
+                                   const program_catalog& _catalog, const dispatch_table& _dispatch,
+                                   log_sink& _exec_log, log_sink& _sys_log, status_mode _status)
+    : ctx(_ctx), cache(_cache), catalog(_catalog), dispatch(_dispatch), exec_log(_exec_log), sys_log(_sys_log), status(_status) {}
+
+int nested_simulator::run(shared_ptr<const compiled_program> program, PCB init, int time) {
+    base_depth = 0;
+    return execute({move(program), 0, branch::NONE}, move(init), time);
+}
+
+int nested_simulator::run_child(shared_ptr<const compiled_program> program, size_t pc, PCB child, int time) {
+    base_depth = ctx.wait_queue.size();   // its ancestors, run by someone else
+    return execute({move(program), pc, branch::CHILD}, move(child), time);
+}
+
+int nested_simulator::execute(frame start, PCB process, int time) {
+    PROFILE_SCOPE(profile_counter::SIMULATE);
+    current = move(process);
+    t = time;
+    frames.clear();
+    table.clear();
+    if (status == status_mode::DELTA)
+        table.add(current.PID, current.PPID, current.program_name, current.size, current.partition_number,
+                  pcb_state::RUNNING);
+    frames.push_back(move(start));
+    deepest = base_depth + 1;
+    executed = 0;
+
+    while (!frames.empty()) {
+        frame& f = frames.back();
+        const compiled_program& prog = *f.program;
+        if (f.pc >= prog.trace.code.size()) { exit_current(); continue; }
+
+        size_t at = f.pc++;
+        executed++;
+        const instruction& ins = prog.trace.code[at];
+        const int val = ins.value;
+        PROFILE_SCOPE(opcode_counter(ins.op));
+
+        switch (ins.op) {
+        case opcode::FORK:
+            fork(val);   // may push a frame; `f` is stale afterwards
+            break;
+
+        case opcode::EXEC:
+            exec(prog, ins);
+            break;
+
+        case opcode::CPU:
+            write_event(exec_log, t, val, "CPU Burst"); t += val;
+            break;
+
+        case opcode::SYSCALL:
+        case opcode::END_IO:
+            t = dispatch.service(exec_log, t, val, ins.op);
+            break;
+
+        // A parent skips the child's branch and vice versa
+        case opcode::IF_CHILD:
+            if (f.role == branch::PARENT) { f.pc = prog.jump[at]; break; }
+            write_event(exec_log, t, 1, "IF_CHILD"); t += 1;
+            break;
+
+        case opcode::IF_PARENT:
+            if (f.role == branch::CHILD) { f.pc = prog.jump[at]; break; }
+            write_event(exec_log, t, 1, "IF_PARENT"); t += 1;
+            break;
+
+        case opcode::ENDIF:
+            f.role = branch::NONE;
+            write_event(exec_log, t, 1, "ENDIF"); t += 1;
+            break;
+
+        default:
+            exec_log.write_int(t); exec_log.write(", 0, Unknown trace line: ");
+            exec_log.write(prog.trace.literals[ins.program]);
+            exec_log.write('\n');
+        }
+    }
+    return t;
+}
+
+void nested_simulator::fork(int val) {
+    t = dispatch.enter(exec_log, t, 2);
+    write_event(exec_log, t, val, "cloning the PCB"); t += val;
+    write_event(exec_log, t, 0, "scheduler called");
+    t = dispatch.iret(exec_log, t, 2);
+
+    frame& parent = frames.back();
+    parent.role = branch::PARENT;
+
+    // Before anything is taken for the child: an exception past here would leak its partition
+    if (base_depth + frames.size() >= MAX_DEPTH) throw runtime_error("fork depth limit reached");
+    PCB child(ctx.next_pid++, current.PID, current.program_name, current.size, -1);
+    if (!allocate_memory(ctx, &child)) {
+        write_event(exec_log, t, 0, "FORK failed (no memory)");
+        fork_failures++;
+        snapshot("FORK", val);
+        return;
+    }
+
+    frame child_frame{parent.program, parent.pc, branch::CHILD};
+    ctx.wait_queue.push_back(current);
+    if (status == status_mode::DELTA) {
+        table.set_state(current.PID, pcb_state::WAITING);
+        table.add(child.PID, child.PPID, child.program_name, child.size, child.partition_number,
+                  pcb_state::RUNNING);
+    }
+    current = child;
+    frames.push_back(move(child_frame));
+    created++;
+    deepest = max(deepest, base_depth + frames.size());
+    snapshot("FORK", val);
+
+    // Someone else runs the child; to the parent it has already exited
+    if (hooks && hooks->take_child(*this)) exit_current();
+}
+
+void nested_simulator::exec(const compiled_program& image, const instruction& ins) {
+    // `image` belongs to the frame we are about to overwrite; keep it alive
+    shared_ptr<const compiled_program> old = frames.back().program;
+    const string& name = image.names.name(ins.program);
+    const string& file = image.names.name(ins.image);
+    const int val = ins.value;
+
+    t = dispatch.enter(exec_log, t, 3);
+
+    // Like execve(), a missing program fails and the old image keeps running
+    shared_ptr<const compiled_program> body = cache.get(file);
+    if (!body) {
+        write_event(exec_log, t, 0, "EXEC failed (" + file + ".txt not found)");
+        return;
+    }
+
+    const program_entry* entry = catalog.find(file);
+    if (!entry) entry = catalog.find(name);
+    unsigned prog_size = entry ? entry->size : 0;
+
+    exec_log.write_int(t); exec_log.write(", "); exec_log.write_int(val);
+    exec_log.write(", Program is "); exec_log.write_int(prog_size); exec_log.write("MB large\n"); t += val;
+    int load_time = dispatch.load_time(prog_size);
+    write_event(exec_log, t, load_time, "loading program into memory"); t += load_time;
+    write_event(exec_log, t, 3, "marking partition as occupied"); t += 3;
+    write_event(exec_log, t, 6, "updating PCB"); t += 6;
+    write_event(exec_log, t, 0, "scheduler called");
+    t = dispatch.iret(exec_log, t, 3);
+
+    free_memory(ctx, &current);
+    current.program_name = name;
+    current.size = prog_size;
+    if (!allocate_memory(ctx, &current)) {
+        write_event(exec_log, t, 0, "EXEC failed (no memory)");
+        exit_current();
+        return;
+    }
+    if (status == status_mode::DELTA) {
+        table.set_program(current.PID, name, prog_size);
+        table.set_partition(current.PID, current.partition_number);
+    }
+    snapshot("EXEC " + name, val);
+
+    frames.back() = frame{move(body), 0, branch::NONE};
+}
+
+// The running process ends; its parent (the next frame down) resumes
+void nested_simulator::exit_current() {
+    free_memory(ctx, &current);
+    if (status == status_mode::DELTA) table.set_state(current.PID, pcb_state::TERMINATED);
+    frames.pop_back();
+    if (!ctx.wait_queue.empty()) {
+        current = ctx.wait_queue.back();
+        ctx.wait_queue.pop_back();
+        if (status == status_mode::DELTA) table.set_state(current.PID, pcb_state::RUNNING);
+    }
+}
+
+// Delta snapshots only cost the rows that changed; full ones the whole tree
+void nested_simulator::snapshot(string_view label, int val) {
+    if (status == status_mode::DELTA) table.write_delta(sys_log, t, label, val);
+    else if (hooks) hooks->snapshot(t, label, val, current, ctx.wait_queue);
+    else write_snapshot(sys_log, t, label, val, current, ctx.wait_queue);
+}
@@ -0,0 +1,97 @@
+#ifndef NESTED_SIMULATOR_HPP_
+#define NESTED_SIMULATOR_HPP_
+
+#include "interrupts_101297993_101302793.hpp"
+#include "program_cache.hpp"
+
+// ====================== NESTED EXECUTION ======================
+
+class nested_simulator;
+
+// Lets another simulator take over FORKed children (see parallel_nested.hpp).
+// take_child() is called after every successful FORK, once the child is
+// running and the FORK snapshot is out; returning true means the caller
+// runs the child's subtree itself, and this simulator retires the child at
+// once and resumes the parent. With hooks set, FULL snapshots go to
+// snapshot() instead of the status log.
+class fork_hooks {
+public:
+    virtual ~fork_hooks() = default;
+    virtual bool take_child(nested_simulator& sim) = 0;
+    virtual void snapshot(int time, std::string_view label, int val, const PCB& current,
+                          const std::deque<PCB>& wait_queue) = 0;
+};
+
+// Runs traces with real FORK/EXEC semantics instead of the canned timings
+// the legacy simulators use:
+//  - FORK clones the running process. The child runs first: its IF_CHILD
+//    branch, then whatever follows ENDIF. When it exits, the parent resumes
+//    with its IF_PARENT branch and the code after ENDIF.
+//  - EXEC loads the named program file (from the shared program_cache) and
+//    replaces the process image; the rest of the old trace is not run.
+// Processes are kept on an explicit stack, so fork/exec trees hundreds of
+// levels deep don't touch the C++ call stack.
+class nested_simulator {
+public:
+    nested_simulator(simulator_context& ctx, program_cache& cache, const program_catalog& catalog,
+                     const dispatch_table& dispatch, log_sink& exec_log, log_sink& sys_log, status_mode status = status_mode::FULL);
+
+    // Runs `program` as the image of `init` until every process has exited.
+    // Returns the end time.
+    int run(std::shared_ptr<const compiled_program> program, PCB init, int time = 0);
+    // Runs a FORKed child from `pc` of its parent's image, until it exits
+    int run_child(std::shared_ptr<const compiled_program> program, std::size_t pc, PCB child, int time);
+
+    void set_hooks(fork_hooks* _hooks) { hooks = _hooks; }
+    // The running process and where it is; for fork_hooks::take_child
+    const PCB& running() const { return current; }
+    const std::shared_ptr<const compiled_program>& image() const { return frames.back().program; }
+    std::size_t pc() const { return frames.back().pc; }
+    int time() const { return t; }
+    const simulator_context& context() const { return ctx; }
+
+    unsigned processes_created() const { return created; }
+    std::size_t max_depth() const { return deepest; }
+    std::uint64_t instructions() const { return executed; }
+    unsigned failed_forks() const { return fork_failures; }   // FORKs with no free partition
+
+    static constexpr std::size_t MAX_DEPTH = 1 << 20;
+
+private:
+    enum class branch : std::uint8_t { NONE, CHILD, PARENT };
+
+    // Where one process is in its image; frames[i] belongs to
+    // ctx.wait_queue[i], the top frame to `current`
+    struct frame {
+        std::shared_ptr<const compiled_program> program;
+        std::size_t pc;
+        branch role;
+    };
+
+    int execute(frame start, PCB process, int time);
+    void fork(int val);
+    void exec(const compiled_program& image, const instruction& ins);
+    void exit_current();
+    void snapshot(std::string_view label, int val);
+
+    simulator_context& ctx;
+    program_cache& cache;
+    const program_catalog& catalog;
+    const dispatch_table& dispatch;
+    log_sink& exec_log;
+    log_sink& sys_log;
+    status_mode status;
+    fork_hooks* hooks = nullptr;
+
+    std::vector<frame> frames;
+    pcb_table table;   // mirrors current + wait_queue; only kept for delta snapshots
+    PCB current{0, -1, "init", 1, -1};
+    int t = 0;
+    unsigned created = 0;
+    std::size_t base_depth = 0;   // processes below the first frame
+    std::size_t deepest = 0;
+    std::uint64_t executed = 0;
+    unsigned fork_failures = 0;
+};
+
+#endif
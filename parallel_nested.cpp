@@ -0,0 +1,320 @@
+#include "parallel_nested.hpp"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+using namespace std;
+
+// PIDs a branch did not create itself (its ancestors, and its own first
+// process) are written as TAG | index into branch::inherited
+static constexpr unsigned TAG = 0x80000000u;
+
+// One subtree: a process from where it starts until it exits, minus the
+// children it handed off. Times and PIDs are local until place() runs.
+struct parallel_nested_simulator::branch {
+    shared_ptr<const compiled_program> program;
+    size_t pc = 0;
+    bool child = false;
+    PCB process{0, -1, "", 0, -1};
+    simulator_context ctx;
+    vector<unsigned> inherited;   // PIDs behind the tags, in the parent's numbering
+
+    // Output. The exec log is cut at every hand-off; snapshot i belongs to
+    // the piece that was open when it was taken.
+    struct snapshot_record {
+        int time;
+        string label;
+        int val;
+        size_t piece;
+        size_t rows_end;   // rows[previous rows_end, rows_end), the running process first
+    };
+    struct handoff {
+        int time;          // local time the child starts at
+        unsigned pids;     // processes this branch had created, the child included
+        unique_ptr<branch> child;
+    };
+    log_sink exec = log_sink::discard();
+    vector<string> pieces;
+    vector<snapshot_record> snapshots;
+    vector<PCB> rows;
+    vector<handoff> handoffs;
+    int end_time = 0;
+    unsigned created = 0, fork_failures = 0;
+    size_t deepest = 0;
+    uint64_t executed = 0;
+    size_t peak = 0;
+
+    // Filled in by place()
+    long long span = 0;               // time the whole subtree takes
+    unsigned long long spawned = 0;   // PIDs the whole subtree uses
+    long long start = 0;
+    unsigned base = 0;                // absolute PID of local PID 0
+    vector<unsigned> inherited_abs;
+    vector<long long> time_shift;        // per piece, from local to absolute time
+    vector<unsigned long long> pid_shift;   // per piece, PIDs used by earlier handed-off subtrees
+
+    unsigned resolve(unsigned pid) const {
+        if (pid & TAG) return inherited_abs[pid & ~TAG];
+        // Local PIDs made after hand-off i come after that child's subtree
+        size_t piece = upper_bound(handoffs.begin(), handoffs.end(), pid,
+                                   [](unsigned p, const handoff& h) { return p < h.pids; }) - handoffs.begin();
+        return (unsigned)(base + pid + pid_shift[piece]);
+    }
+};
+
+class parallel_nested_simulator::branch_hooks : public fork_hooks {
+public:
+    branch_hooks(parallel_nested_simulator& _owner, branch& _b, bool _recording)
+        : owner(_owner), b(_b), recording(_recording) {}
+
+    bool take_child(nested_simulator& sim) override {
+        if (!owner.eager && owner.queued.load() >= owner.pool.size()) return false;
+        // sim's context still has the child running and the parent waiting
+        unique_ptr<branch> c = owner.make_branch(sim.context(), sim.running());
+        c->program = sim.image();
+        c->pc = sim.pc();
+        c->child = true;
+        b.pieces.push_back(b.exec.enabled() ? b.exec.take() : string());
+        b.handoffs.push_back({sim.time(), b.ctx.next_pid, move(c)});
+        owner.launch(b.handoffs.back().child.get());
+        return true;
+    }
+
+    void snapshot(int time, string_view label, int val, const PCB& current,
+                  const deque<PCB>& wait_queue) override {
+        if (!recording) return;
+        b.rows.push_back(current);
+        b.rows.insert(b.rows.end(), wait_queue.begin(), wait_queue.end());
+        b.snapshots.push_back({time, string(label), val, b.handoffs.size(), b.rows.size()});
+    }
+
+private:
+    parallel_nested_simulator& owner;
+    branch& b;
+    bool recording;
+};
+
+parallel_nested_simulator::parallel_nested_simulator(simulator_context& _ctx, program_cache& _cache,
+                                                     const program_catalog& _catalog,
+                                                     const dispatch_table& _dispatch, log_sink& _exec_log,
+                                                     log_sink& _sys_log, status_mode _status, thread_pool& _pool)
+    : ctx(_ctx), cache(_cache), catalog(_catalog), dispatch(_dispatch), exec_log(_exec_log), sys_log(_sys_log),
+      status(_status), pool(_pool) {}
+
+parallel_nested_simulator::~parallel_nested_simulator() = default;
+
+// ===== BRANCHES =====
+
+// A copy of `from` in which `process` and every waiting process are tagged,
+// and new PIDs count from 0
+unique_ptr<parallel_nested_simulator::branch>
+parallel_nested_simulator::make_branch(const simulator_context& from, const PCB& process) const {
+    auto b = make_unique<branch>();
+    b->ctx = from;
+    b->ctx.next_pid = 0;
+    for (PCB& p : b->ctx.wait_queue) {
+        b->inherited.push_back(p.PID);
+        p.PID = TAG | (unsigned)(b->inherited.size() - 1);
+    }
+    b->process = process;
+    b->inherited.push_back(process.PID);
+    b->process.PID = TAG | (unsigned)(b->inherited.size() - 1);
+    if (exec_log.enabled()) b->exec = log_sink::memory();
+    return b;
+}
+
+void parallel_nested_simulator::launch(branch* b) {
+    queued++;
+    branch_count++;
+    pool.submit([this, b] {
+        queued--;
+        run_branch(*b);
+    });
+}
+
+void parallel_nested_simulator::run_branch(branch& b) {
+    if (abandoned) return;
+    try {
+        branch_hooks hooks(*this, b, sys_log.enabled());
+        log_sink no_status = log_sink::discard();   // snapshots go to the hooks
+        nested_simulator sim(b.ctx, cache, catalog, dispatch, b.exec, no_status, status);
+        sim.set_hooks(&hooks);
+
+        // What the parent carried on with: this table without the first process
+        partition_manager expected = b.ctx.partitions;
+        expected.release(b.process.partition_number);
+
+        b.end_time = b.child ? sim.run_child(b.program, b.pc, b.process, 0) : sim.run(b.program, b.process, 0);
+        b.pieces.push_back(b.exec.enabled() ? b.exec.take() : string());
+        b.created = sim.processes_created();
+        b.fork_failures = sim.failed_forks();
+        b.deepest = sim.max_depth();
+        b.executed = sim.instructions();
+        b.peak = b.ctx.partitions.peak_used();
+        if (b.child && !b.ctx.partitions.same_occupancy(expected)) abandoned = true;
+    } catch (const exception&) {
+        abandoned = true;   // the serial rerun reports it
+    }
+}
+
+// ===== MERGE =====
+
+// Every branch, parents before their children. Iterative, since a chain of
+// handed-off children can be as deep as the fork tree.
+vector<parallel_nested_simulator::branch*> parallel_nested_simulator::tree_order(branch& root) {
+    vector<branch*> order{&root};
+    for (size_t i = 0; i < order.size(); i++)
+        for (auto& h : order[i]->handoffs) order.push_back(h.child.get());
+    return order;
+}
+
+// Spans bottom-up, then start times and PID bases top-down
+void parallel_nested_simulator::place(const vector<branch*>& order, long long start, unsigned base) {
+    for (size_t i = order.size(); i-- > 0;) {
+        branch& b = *order[i];
+        b.span = b.end_time;
+        b.spawned = b.ctx.next_pid;
+        for (auto& h : b.handoffs) {
+            b.span += h.child->span;
+            b.spawned += h.child->spawned;
+        }
+    }
+
+    branch& root = *order.front();
+    root.start = start;
+    root.base = base;
+    root.inherited_abs = root.inherited;
+    for (branch* bp : order) {
+        branch& b = *bp;
+        b.time_shift.assign(1, b.start);
+        b.pid_shift.assign(1, 0);
+        for (auto& h : b.handoffs) {
+            branch& c = *h.child;
+            c.start = b.time_shift.back() + h.time;
+            c.base = (unsigned)(b.base + h.pids + b.pid_shift.back());   // right after the child's own PID
+            b.time_shift.push_back(b.time_shift.back() + c.span);
+            b.pid_shift.push_back(b.pid_shift.back() + c.spawned);
+        }
+        for (auto& h : b.handoffs) {
+            branch& c = *h.child;
+            for (unsigned pid : c.inherited) c.inherited_abs.push_back(b.resolve(pid));
+        }
+    }
+}
+
+// Adds `shift` to the time that starts every line
+static void shift_times(string_view text, long long shift, log_sink& out) {
+    if (shift == 0) { out.write(text); return; }
+    while (!text.empty()) {
+        size_t nl = text.find('\n');
+        string_view line = text.substr(0, nl == string_view::npos ? text.size() : nl + 1);
+        long long t;
+        auto [end, ec] = from_chars(line.data(), line.data() + line.size(), t);
+        if (ec == errc()) {
+            out.write_int(t + shift);
+            out.write(line.substr(end - line.data()));
+        } else {
+            out.write(line);
+        }
+        text.remove_prefix(line.size());
+    }
+}
+
+// Rewrites the branch's pieces and snapshots in absolute time and PIDs; the
+// exec log piece i is replaced by its shifted text, and the snapshots of
+// piece i are formatted into the matching status piece
+void parallel_nested_simulator::format(branch& b) {
+    vector<string> status(b.pieces.size());
+    if (exec_log.enabled()) {
+        log_sink out = log_sink::memory();
+        for (size_t i = 0; i < b.pieces.size(); i++) {
+            shift_times(b.pieces[i], b.time_shift[i], out);
+            b.pieces[i] = out.take();
+        }
+    }
+    if (sys_log.enabled()) {
+        vector<PCB> rows;
+        size_t first = 0;
+        size_t piece = 0;
+        log_sink out = log_sink::memory();
+        for (const auto& s : b.snapshots) {
+            for (; piece < s.piece; piece++) status[piece] = out.take();
+            rows.assign(b.rows.begin() + first, b.rows.begin() + s.rows_end);
+            for (PCB& p : rows) p.PID = b.resolve(p.PID);
+            write_snapshot(out, (int)(s.time + b.time_shift[s.piece]), s.label, s.val, rows.data(), rows.size());
+            first = s.rows_end;
+        }
+        status[piece] = out.take();
+        b.rows = {};
+        b.snapshots = {};
+    }
+    b.pieces.insert(b.pieces.end(), make_move_iterator(status.begin()), make_move_iterator(status.end()));
+}
+
+// Both logs in serial order: a piece, then the child handed off after it
+void parallel_nested_simulator::emit(branch& root) {
+    vector<pair<branch*, size_t>> stack{{&root, 0}};
+    while (!stack.empty()) {
+        auto& [b, piece] = stack.back();
+        size_t pieces = b->handoffs.size() + 1;
+        exec_log.write(b->pieces[piece]);
+        sys_log.write(b->pieces[pieces + piece]);
+        if (piece + 1 == pieces) { stack.pop_back(); continue; }
+        branch* c = b->handoffs[piece++].child.get();
+        stack.push_back({c, 0});
+    }
+}
+
+// ===== RUN =====
+
+int parallel_nested_simulator::run_serial(shared_ptr<const compiled_program> program, PCB init, int time) {
+    serial = true;
+    nested_simulator sim(ctx, cache, catalog, dispatch, exec_log, sys_log, status);
+    int end = sim.run(move(program), move(init), time);
+    created = sim.processes_created();
+    deepest = sim.max_depth();
+    executed = sim.instructions();
+    fork_failures = sim.failed_forks();
+    return end;
+}
+
+int parallel_nested_simulator::run(shared_ptr<const compiled_program> program, PCB init, int time) {
+    if (status == status_mode::DELTA || (pool.size() < 2 && !eager)) return run_serial(move(program), move(init), time);
+
+    const simulator_context initial = ctx;
+    unique_ptr<branch> root = make_branch(ctx, init);
+    root->program = program;
+    abandoned = false;
+    branch_count = 0;
+    launch(root.get());
+    pool.wait();
+    if (abandoned) {
+        ctx = initial;
+        return run_serial(move(program), move(init), time);
+    }
+
+    serial = false;
+    const vector<branch*> order = tree_order(*root);
+    place(order, time, ctx.next_pid);
+    for (branch* b : order) pool.submit([this, b] { format(*b); });
+    pool.wait();
+    emit(*root);
+
+    created = 0;
+    fork_failures = 0;
+    executed = 0;
+    deepest = 0;
+    for (branch* b : order) {
+        created += b->created;
+        fork_failures += b->fork_failures;
+        executed += b->executed;
+        deepest = max(deepest, b->deepest);
+        root->ctx.partitions.note_peak(b->peak);
+    }
+
+    // Leave ctx as the serial run would have
+    for (PCB& p : root->ctx.wait_queue) p.PID = root->resolve(p.PID);
+    root->ctx.next_pid = (unsigned)(ctx.next_pid + root->spawned);
+    ctx = move(root->ctx);
+    return (int)(time + root->span);
+}
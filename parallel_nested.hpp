@@ -0,0 +1,84 @@
+#ifndef PARALLEL_NESTED_HPP_
+#define PARALLEL_NESTED_HPP_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "nested_simulator.hpp"
+#include "thread_pool.hpp"
+
+// ==================== PARALLEL FORK SUBTREES ====================
+
+// nested_simulator with FORKed subtrees spread over a thread pool. The logs
+// are byte for byte the serial engine's.
+//
+// A child's subtree gives back every partition it takes before its parent
+// resumes, so the parent carries on at once from the partition table it had
+// before the FORK while the child runs on another worker. Every branch
+// counts time from 0 and numbers the processes it creates from 0. Once all
+// branches are done, each is shifted by the time and PIDs that the branches
+// before it used, and the logs are written out in the serial order. A child is
+// only handed off while some worker is likely idle, so small subtrees mostly
+// stay inline.
+//
+// Falls back to the serial engine for --status-delta (every delta depends on
+// the one before), and reruns the whole trace serially when a branch throws
+// or a subtree ends with a partition table other than the one its parent
+// carried on with.
+class parallel_nested_simulator {
+public:
+    parallel_nested_simulator(simulator_context& ctx, program_cache& cache, const program_catalog& catalog,
+                              const dispatch_table& dispatch, log_sink& exec_log, log_sink& sys_log,
+                              status_mode status, thread_pool& pool);
+    ~parallel_nested_simulator();
+
+    // Same contract as nested_simulator::run
+    int run(std::shared_ptr<const compiled_program> program, PCB init, int time = 0);
+
+    unsigned processes_created() const { return created; }
+    std::size_t max_depth() const { return deepest; }
+    std::uint64_t instructions() const { return executed; }
+    unsigned failed_forks() const { return fork_failures; }
+    std::size_t branches() const { return branch_count; }   // 1 when nothing was handed off
+    bool ran_serially() const { return serial; }
+
+    // Hand off every FORKed child, idle workers or not; for testing the merge
+    void split_every_fork(bool on) { eager = on; }
+
+private:
+    struct branch;
+    class branch_hooks;
+
+    static std::vector<branch*> tree_order(branch& root);
+
+    std::unique_ptr<branch> make_branch(const simulator_context& from, const PCB& process) const;
+    void launch(branch* b);
+    void run_branch(branch& b);
+    void place(const std::vector<branch*>& order, long long start, unsigned base);
+    void format(branch& b);
+    void emit(branch& root);
+    int run_serial(std::shared_ptr<const compiled_program> program, PCB init, int time);
+
+    simulator_context& ctx;
+    program_cache& cache;
+    const program_catalog& catalog;
+    const dispatch_table& dispatch;
+    log_sink& exec_log;
+    log_sink& sys_log;
+    status_mode status;
+    thread_pool& pool;
+
+    bool eager = false;
+    std::atomic<unsigned> queued{0};        // branches submitted but not started
+    std::atomic<bool> abandoned{false};     // a branch threw or found a conflict
+    std::atomic<std::size_t> branch_count{0};
+
+    unsigned created = 0;
+    std::size_t deepest = 0;
+    std::uint64_t executed = 0;
+    unsigned fork_failures = 0;
+    bool serial = false;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "partition_manager.hpp"
+#include "trace_reader.hpp"
+#include "text_scan.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+
+using namespace std;
+
+const char* policy_name(placement_policy policy) {
+    switch (policy) {
+        case placement_policy::FIRST_FIT: return "first";
+        case placement_policy::BEST_FIT:  return "best";
+        case placement_policy::WORST_FIT: return "worst";
+        default:                          return "legacy";
+    }
+}
+
+bool parse_policy(string_view name, placement_policy& policy) {
+    if (name == "legacy") policy = placement_policy::LEGACY;
+    else if (name == "first") policy = placement_policy::FIRST_FIT;
+    else if (name == "best") policy = placement_policy::BEST_FIT;
+    else if (name == "worst") policy = placement_policy::WORST_FIT;
+    else return false;
+    return true;
+}
+
+partition_manager::partition_manager(vector<unsigned> _sizes, placement_policy _policy)
+    : placement(_policy), sizes(move(_sizes)) {
+    if (sizes.empty()) throw invalid_argument("partition table is empty");
+    owners.assign(sizes.size(), EMPTY);
+    occupied.assign((sizes.size() + 63) / 64, 0);
+
+    while (leaves < sizes.size()) leaves <<= 1;
+    tree.assign(2 * leaves, 0);
+
+    class_size = sizes;
+    sort(class_size.begin(), class_size.end());
+    class_size.erase(unique(class_size.begin(), class_size.end()), class_size.end());
+    class_free.resize(class_size.size());
+    class_nonempty.assign((class_size.size() + 63) / 64, 0);
+    class_of.resize(sizes.size());
+    for (size_t i = 0; i < sizes.size(); i++)
+        class_of[i] = (uint32_t)(lower_bound(class_size.begin(), class_size.end(), sizes[i]) - class_size.begin());
+
+    clear();
+}
+
+void partition_manager::clear() {
+    fill(owners.begin(), owners.end(), EMPTY);
+    fill(occupied.begin(), occupied.end(), 0);
+    used_count = peak_count = 0;
+
+    fill(tree.begin(), tree.end(), 0);
+    for (size_t i = 0; i < sizes.size(); i++) tree[leaves + i] = (uint64_t)sizes[i] + 1;
+    for (size_t n = leaves - 1; n >= 1; n--) tree[n] = max(tree[2 * n], tree[2 * n + 1]);
+
+    for (auto& list : class_free) list.clear();
+    for (size_t i = 0; i < sizes.size(); i++) class_free[class_of[i]].insert((uint32_t)i);
+    fill(class_nonempty.begin(), class_nonempty.end(), 0);
+    for (size_t c = 0; c < class_size.size(); c++) class_nonempty[c >> 6] |= 1ull << (c & 63);
+}
+
+// Flip one partition between free and taken in every index structure
+void partition_manager::mark(size_t i, bool taken) {
+    if (taken) { occupied[i >> 6] |= 1ull << (i & 63); peak_count = max(peak_count, ++used_count); }
+    else { occupied[i >> 6] &= ~(1ull << (i & 63)); used_count--; }
+
+    size_t n = leaves + i;
+    tree[n] = taken ? 0 : (uint64_t)sizes[i] + 1;
+    for (n >>= 1; n >= 1; n >>= 1) tree[n] = max(tree[2 * n], tree[2 * n + 1]);
+
+    uint32_t c = class_of[i];
+    if (taken) class_free[c].erase((uint32_t)i);
+    else class_free[c].insert((uint32_t)i);
+    if (class_free[c].empty()) class_nonempty[c >> 6] &= ~(1ull << (c & 63));
+    else class_nonempty[c >> 6] |= 1ull << (c & 63);
+}
+
+// Leftmost (or rightmost) free partition with room, by walking the max-tree
+int partition_manager::find_by_index(unsigned size, bool from_end) const {
+    uint64_t need = (uint64_t)size + 1;   // 64-bit so UINT_MAX does not wrap to 0
+    if (tree[1] < need) return -1;
+    size_t n = 1;
+    while (n < leaves) {
+        size_t first = from_end ? 2 * n + 1 : 2 * n;
+        size_t second = from_end ? 2 * n : 2 * n + 1;
+        n = tree[first] >= need ? first : second;
+    }
+    return (int)(n - leaves);
+}
+
+// Smallest (or largest) non-empty size class that fits
+int partition_manager::find_by_class(unsigned size, bool smallest) const {
+    if (smallest) {
+        size_t c = lower_bound(class_size.begin(), class_size.end(), size) - class_size.begin();
+        for (size_t w = c >> 6; w < class_nonempty.size(); w++) {
+            uint64_t bits = class_nonempty[w];
+            if (w == (c >> 6)) bits &= ~0ull << (c & 63);
+            if (bits) return (int)*class_free[(w << 6) + __builtin_ctzll(bits)].rbegin();
+        }
+        return -1;
+    }
+    for (size_t w = class_nonempty.size(); w-- > 0;) {
+        if (!class_nonempty[w]) continue;
+        size_t c = (w << 6) + 63 - __builtin_clzll(class_nonempty[w]);
+        return class_size[c] >= size ? (int)*class_free[c].rbegin() : -1;
+    }
+    return -1;
+}
+
+int partition_manager::allocate(unsigned size, int32_t owner) {
+    int i;
+    switch (placement) {
+        case placement_policy::FIRST_FIT: i = find_by_index(size, false); break;
+        case placement_policy::BEST_FIT:  i = find_by_class(size, true); break;
+        case placement_policy::WORST_FIT: i = find_by_class(size, false); break;
+        default:                          i = find_by_index(size, true); break;
+    }
+    if (i < 0) return -1;
+    mark((size_t)i, true);
+    owners[i] = owner;
+    return i + 1;
+}
+
+void partition_manager::release(int partition_number) {
+    if (partition_number < 1 || (size_t)partition_number > sizes.size()) return;
+    size_t i = (size_t)partition_number - 1;
+    if (is_free(partition_number)) return;
+    owners[i] = EMPTY;
+    mark(i, false);
+}
+
+void partition_manager::occupy(int partition_number, int32_t owner) {
+    if (partition_number < 1 || (size_t)partition_number > sizes.size()) return;
+    size_t i = (size_t)partition_number - 1;
+    if (is_free(partition_number)) mark(i, true);
+    owners[i] = owner;
+}
+
+vector<unsigned> parse_partition_sizes(const string& spec) {
+    string text;
+    struct stat st;
+    if (stat(spec.c_str(), &st) == 0) {
+        auto reader = line_reader::open(spec);
+        string_view line;
+        while (reader->next(line)) { text.append(line); text += ','; }
+    } else {
+        text = spec;
+    }
+
+    vector<unsigned> sizes;
+    size_t pos = 0;
+    while (pos <= text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == string::npos) end = text.size();
+        string_view field = string_view(text).substr(pos, end - pos);
+        if (field.find_first_not_of(" \t\n\v\f\r") != string_view::npos) {
+            int size;
+            if (!parse_int_exact(field, size) || size <= 0)
+                throw invalid_argument("bad partition size '" + string(field) + "' (expected a positive number of MB)");
+            sizes.push_back((unsigned)size);
+        }
+        pos = end + 1;
+    }
+    if (sizes.empty()) throw invalid_argument("no partition sizes in '" + spec + "'");
+    return sizes;
+}
@@ -0,0 +1,82 @@
+#ifndef PARTITION_MANAGER_HPP_
+#define PARTITION_MANAGER_HPP_
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ====================== PARTITION MANAGER ======================
+
+// LEGACY is the original allocator: the highest-numbered free partition
+// that is big enough.
+enum class placement_policy { LEGACY, FIRST_FIT, BEST_FIT, WORST_FIT };
+
+const char* policy_name(placement_policy policy);
+bool parse_policy(std::string_view name, placement_policy& policy);
+
+// Fixed partitions numbered from 1. Owners are program-name ids (-1 = empty).
+//  - an occupancy bitmap answers "is partition n free" and counts usage
+//  - a max-tree over free sizes finds the first / last fitting partition
+//    (FIRST_FIT, LEGACY) in O(log n)
+//  - one ordered free set per distinct size plus a bitmap of non-empty
+//    classes serves BEST_FIT / WORST_FIT in O(log n); ties go to the
+//    highest partition number
+class partition_manager {
+public:
+    static constexpr std::int32_t EMPTY = -1;
+
+    explicit partition_manager(std::vector<unsigned> sizes = default_sizes(),
+                               placement_policy policy = placement_policy::LEGACY);
+
+    static std::vector<unsigned> default_sizes() { return {40, 25, 15, 10, 8, 2}; }
+
+    // Returns the partition number, or -1 if no free partition fits
+    int allocate(unsigned size, std::int32_t owner);
+    void release(int partition_number);   // out-of-range numbers are ignored
+    void occupy(int partition_number, std::int32_t owner);   // restores a saved allocation
+    void clear();
+
+    placement_policy policy() const { return placement; }
+    void set_policy(placement_policy policy) { placement = policy; }
+
+    std::size_t count() const { return sizes.size(); }
+    std::size_t used() const { return used_count; }
+    std::size_t peak_used() const { return peak_count; }   // most partitions taken at once
+    // For tables copied off this one and run separately: fold their peaks back in
+    void note_peak(std::size_t used) { if (used > peak_count) peak_count = used; }
+    // The same partitions are taken, whoever owns them
+    bool same_occupancy(const partition_manager& other) const { return occupied == other.occupied; }
+    unsigned size_of(int partition_number) const { return sizes[partition_number - 1]; }
+    std::int32_t owner(int partition_number) const { return owners[partition_number - 1]; }
+    bool is_free(int partition_number) const {
+        std::size_t i = partition_number - 1;
+        return !(occupied[i >> 6] >> (i & 63) & 1);
+    }
+
+private:
+    int find_by_index(unsigned size, bool from_end) const;
+    int find_by_class(unsigned size, bool smallest) const;
+    void mark(std::size_t index, bool taken);
+
+    placement_policy placement;
+    std::vector<unsigned> sizes;
+    std::vector<std::int32_t> owners;
+    std::vector<std::uint64_t> occupied;
+    std::size_t used_count = 0;
+    std::size_t peak_count = 0;
+
+    std::vector<std::uint64_t> tree;   // leaves hold size+1 when free, 0 when taken
+    std::size_t leaves = 1;
+
+    std::vector<unsigned> class_size;                 // ascending distinct sizes
+    std::vector<std::uint32_t> class_of;              // partition index -> class
+    std::vector<std::set<std::uint32_t>> class_free;  // free partition indices per class, ordered
+    std::vector<std::uint64_t> class_nonempty;
+};
+
+// Comma or newline separated sizes, either inline ("40,25,15") or in a file
+std::vector<unsigned> parse_partition_sizes(const std::string& spec);
+
+#endif
@@ -0,0 +1,164 @@
+#include "pcb_table.hpp"
+#include "profile.hpp"
+
+using namespace std;
+
+static const char* const STATE_NAMES[] = {"running", "ready", "waiting", "blocked", "done"};
+
+const char* pcb_state_name(pcb_state state) {
+    return STATE_NAMES[(int)state];
+}
+
+bool parse_pcb_state(string_view name, pcb_state& state) {
+    for (int i = 0; i <= (int)pcb_state::TERMINATED; i++) {
+        if (name == STATE_NAMES[i]) { state = (pcb_state)i; return true; }
+    }
+    return false;
+}
+
+void pcb_table::add(unsigned pid, int ppid, string_view program, unsigned size, int partition,
+                    pcb_state state) {
+    if (pid >= present.size()) {
+        size_t n = pid + 1;
+        ppids.resize(n, -1);
+        programs.resize(n, 0);
+        sizes.resize(n, 0);
+        partitions.resize(n, -1);
+        states.resize(n, pcb_state::TERMINATED);
+        present.resize(n, 0);
+        dirty_flags.resize(n, 0);
+    }
+    if (!present[pid] || states[pid] == pcb_state::TERMINATED) {
+        if (state != pcb_state::TERMINATED) live_rows++;
+    } else if (state == pcb_state::TERMINATED) {
+        live_rows--;
+    }
+    ppids[pid] = ppid;
+    programs[pid] = names.intern(program);
+    sizes[pid] = size;
+    partitions[pid] = partition;
+    states[pid] = state;
+    present[pid] = 1;
+    touch(pid);
+}
+
+void pcb_table::set_program(unsigned pid, string_view program, unsigned size) {
+    programs[pid] = names.intern(program);
+    sizes[pid] = size;
+    touch(pid);
+}
+
+void pcb_table::set_partition(unsigned pid, int partition) {
+    partitions[pid] = partition;
+    touch(pid);
+}
+
+void pcb_table::set_state(unsigned pid, pcb_state state) {
+    if (states[pid] == state) return;
+    if (state == pcb_state::TERMINATED) live_rows--;
+    else if (states[pid] == pcb_state::TERMINATED) live_rows++;
+    states[pid] = state;
+    touch(pid);
+}
+
+void pcb_table::clear() {
+    ppids.clear(); programs.clear(); sizes.clear(); partitions.clear();
+    states.clear(); present.clear(); dirty_flags.clear(); dirty.clear();
+    live_rows = 0;
+}
+
+void pcb_table::set_changed(const vector<uint32_t>& pids) {
+    mark_clean();
+    for (uint32_t pid : pids) touch(pid);
+}
+
+void pcb_table::touch(unsigned pid) {
+    if (!dirty_flags[pid]) { dirty_flags[pid] = 1; dirty.push_back(pid); }
+}
+
+void pcb_table::mark_clean() {
+    for (uint32_t pid : dirty) dirty_flags[pid] = 0;
+    dirty.clear();
+}
+
+// ===== SNAPSHOTS =====
+
+static const char BORDER[] = "+------------------------------------------------------+\n";
+
+static void write_header(log_sink& out, long long time, string_view label, int val) {
+    out.write("time: "); out.write_int(time); out.write("; current trace: ");
+    out.write(label); out.write(", "); out.write_int(val); out.write('\n');
+}
+
+static void write_table_header(log_sink& out, long long time, string_view label, int val) {
+    write_header(out, time, label, val);
+    out.write(BORDER);
+    out.write("| PID |program name |partition number | size |   state |\n");
+    out.write(BORDER);
+}
+
+void pcb_table::write_table(log_sink& out, long long time, string_view label, int val) {
+    mark_clean();
+    if (!out.enabled()) return;
+
+    write_table_header(out, time, label, val);
+    for (unsigned pid = 0; pid < present.size(); pid++) {
+        if (!present[pid] || states[pid] == pcb_state::TERMINATED) continue;
+        out.write("| "); out.write_padded_int(pid, 3, false);
+        out.write(" |"); out.write_padded(program(pid), 12, true);
+        out.write(" |"); out.write_padded_int(partitions[pid], 16, false);
+        out.write(" |"); out.write_padded_int(sizes[pid], 5, false);
+        out.write(" |"); out.write_padded(pcb_state_name(states[pid]), 8, true);
+        out.write(" |\n");
+    }
+    out.write(BORDER);
+    out.write('\n');
+}
+
+void pcb_table::write_queue(log_sink& out, long long time, string_view label, int val, unsigned running,
+                            const deque<uint32_t>& waiting) {
+    mark_clean();
+    if (!out.enabled()) return;
+    PROFILE_SCOPE(profile_counter::FORMAT_SNAPSHOT);
+
+    write_table_header(out, time, label, val);
+    auto row = [&](unsigned pid, bool first) {
+        out.write("| "); out.write_padded_int(pid, 3, !first);
+        out.write(" |"); out.write_padded(program(pid), 12, true);
+        out.write(" |"); out.write_padded_int(partitions[pid], 16, false);
+        out.write(" |"); out.write_padded_int(sizes[pid], 5, false);
+        out.write(" |"); out.write_padded(pcb_state_name(states[pid]), 8, true);
+        out.write(" |\n");
+    };
+    row(running, true);
+    for (uint32_t pid : waiting) row(pid, false);
+    out.write(BORDER);
+    out.write('\n');
+}
+
+void pcb_table::write_delta(log_sink& out, long long time, string_view label, int val) {
+    if (out.enabled()) {
+        write_header(out, time, label, val);
+        for (uint32_t pid : dirty) {
+            if (states[pid] == pcb_state::TERMINATED) {
+                out.write("- "); out.write_int(pid); out.write('\n');
+                continue;
+            }
+            out.write("+ "); out.write_int(pid);
+            out.write(' '); out.write_int(ppids[pid]);
+            out.write(' '); out.write(program(pid));
+            out.write(' '); out.write_int(partitions[pid]);
+            out.write(' '); out.write_int(sizes[pid]);
+            out.write(' '); out.write(pcb_state_name(states[pid]));
+            out.write('\n');
+        }
+        out.write('\n');
+    }
+    mark_clean();
+}
+
+void pcb_table::write_snapshot(log_sink& out, status_mode mode, long long time, string_view label, int val) {
+    PROFILE_SCOPE(profile_counter::FORMAT_SNAPSHOT);
+    if (mode == status_mode::DELTA) write_delta(out, time, label, val);
+    else write_table(out, time, label, val);
+}
@@ -0,0 +1,84 @@
+#ifndef PCB_TABLE_HPP_
+#define PCB_TABLE_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "log_writer.hpp"
+#include "trace_compiler.hpp"
+
+// ========================= PCB TABLE =========================
+
+enum class pcb_state : std::uint8_t { RUNNING, READY, WAITING, BLOCKED, TERMINATED };
+
+const char* pcb_state_name(pcb_state state);
+bool parse_pcb_state(std::string_view name, pcb_state& state);
+
+// How the system status log is written: the whole table at every snapshot,
+// or only the rows that changed since the previous one
+enum class status_mode : std::uint8_t { FULL, DELTA };
+
+// Process control blocks stored column by column, one row per PID. Rows never
+// move, so a PID is its own index; program names are interned. Every setter
+// marks its row dirty so a snapshot can write just the rows that changed.
+class pcb_table {
+public:
+    void add(unsigned pid, int ppid, std::string_view program, unsigned size, int partition,
+             pcb_state state);
+    bool contains(unsigned pid) const { return pid < present.size() && present[pid]; }
+
+    int ppid(unsigned pid) const { return ppids[pid]; }
+    const std::string& program(unsigned pid) const { return names.name(programs[pid]); }
+    unsigned size(unsigned pid) const { return sizes[pid]; }
+    int partition(unsigned pid) const { return partitions[pid]; }
+    pcb_state state(unsigned pid) const { return states[pid]; }
+
+    void set_program(unsigned pid, std::string_view program, unsigned size);
+    void set_partition(unsigned pid, int partition);
+    void set_state(unsigned pid, pcb_state state);
+
+    std::size_t rows() const { return present.size(); }   // highest PID + 1
+    std::size_t live() const { return live_rows; }
+    void clear();
+
+    // Snapshot headed "time: <t>; current trace: <label>, <val>", like the
+    // legacy status log. write_table lists every live row in PID order;
+    // write_delta lists the dirty rows as
+    //   + <pid> <ppid> <program> <partition> <size> <state>
+    //   - <pid>                      (terminated)
+    // Both mark the table clean.
+    void write_table(log_sink& out, long long time, std::string_view label, int val);
+    void write_delta(log_sink& out, long long time, std::string_view label, int val);
+    void write_snapshot(log_sink& out, status_mode mode, long long time, std::string_view label, int val);
+    // The legacy full layout: `running`, then `waiting` in queue order, with
+    // only the first PID right-aligned as the old setw() stream left it.
+    // Marks the table clean.
+    void write_queue(log_sink& out, long long time, std::string_view label, int val, unsigned running,
+                     const std::deque<std::uint32_t>& waiting);
+
+    // Rows changed since the last snapshot, in the order write_delta lists
+    // them, so a checkpoint can carry a delta log on exactly. set_changed()
+    // puts them back; every PID must be a row.
+    const std::vector<std::uint32_t>& changed() const { return dirty; }
+    void set_changed(const std::vector<std::uint32_t>& pids);
+
+private:
+    void touch(unsigned pid);
+    void mark_clean();
+
+    std::vector<std::int32_t> ppids;
+    std::vector<std::uint32_t> programs;   // ids into `names`
+    std::vector<std::uint32_t> sizes;
+    std::vector<std::int32_t> partitions;
+    std::vector<pcb_state> states;
+    std::vector<std::uint8_t> present;
+    std::vector<std::uint8_t> dirty_flags;
+    std::vector<std::uint32_t> dirty;
+    std::size_t live_rows = 0;
+    string_pool names;
+};
+
+#endif
@@ -0,0 +1,144 @@
+#include "profile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+static const char* const COUNTER_NAMES[] = {
+    "parse", "simulate", "format.boilerplate", "format.snapshot", "write",
+    "op.FORK", "op.EXEC", "op.CPU", "op.SYSCALL", "op.END_IO",
+    "op.IF_CHILD", "op.IF_PARENT", "op.ENDIF", "op.UNKNOWN",
+    "alloc.allocate", "alloc.free"
+};
+static_assert(sizeof(COUNTER_NAMES) / sizeof(*COUNTER_NAMES) == (size_t)profile_counter::COUNT,
+              "every profile_counter needs a name");
+
+const char* profile_counter_name(profile_counter counter) {
+    return COUNTER_NAMES[(int)counter];
+}
+
+#ifdef SIM_PROFILE
+
+namespace {
+
+constexpr size_t COUNTERS = (size_t)profile_counter::COUNT;
+
+struct trace_event {
+    profile_counter counter;
+    uint64_t start_ns, duration_ns;
+};
+
+// Each thread updates its own block, so timing never takes a lock; blocks
+// stay registered after their thread exits so the report still sees them
+struct thread_profile {
+    unsigned tid = 0;
+    uint64_t calls[COUNTERS] = {};
+    uint64_t ns[COUNTERS] = {};
+    vector<trace_event> events;
+};
+
+mutex registry_lock;
+vector<unique_ptr<thread_profile>> registry;
+atomic<bool> record_events{false};
+const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+thread_profile& local_profile() {
+    thread_local thread_profile* mine = nullptr;
+    if (!mine) {
+        lock_guard<mutex> guard(registry_lock);
+        registry.push_back(make_unique<thread_profile>());
+        mine = registry.back().get();
+        mine->tid = (unsigned)registry.size();
+    }
+    return *mine;
+}
+
+}   // namespace
+
+profile_scope::~profile_scope() {
+    auto end = chrono::steady_clock::now();
+    uint64_t ns = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(end - start).count();
+    thread_profile& p = local_profile();
+    p.calls[(int)counter]++;
+    p.ns[(int)counter] += ns;
+    if (record_events.load(memory_order_relaxed) && p.events.size() < MAX_TRACE_EVENTS) {
+        uint64_t at = (uint64_t)chrono::duration_cast<chrono::nanoseconds>(start - epoch).count();
+        p.events.push_back({counter, at, ns});
+    }
+}
+
+bool profile_enabled() { return true; }
+
+void profile_record_events(bool on) { record_events = on; }
+
+void profile_reset() {
+    lock_guard<mutex> guard(registry_lock);
+    for (auto& p : registry) {
+        fill(begin(p->calls), end(p->calls), 0);
+        fill(begin(p->ns), end(p->ns), 0);
+        p->events.clear();
+    }
+}
+
+static ofstream open_report(const string& path) {
+    ofstream out(path);
+    if (!out) throw runtime_error("cannot open " + path + " for writing");
+    return out;
+}
+
+void profile_write_reports(const string& prefix) {
+    lock_guard<mutex> guard(registry_lock);
+    uint64_t calls[COUNTERS] = {}, ns[COUNTERS] = {};
+    for (const auto& p : registry) {
+        for (size_t i = 0; i < COUNTERS; i++) { calls[i] += p->calls[i]; ns[i] += p->ns[i]; }
+    }
+
+    ofstream json = open_report(prefix + ".json");
+    ofstream csv = open_report(prefix + ".csv");
+    json << "{\n  \"threads\": " << registry.size() << ",\n  \"counters\": [\n";
+    csv << "counter,calls,total_ns,mean_ns\n";
+    bool first = true;
+    for (size_t i = 0; i < COUNTERS; i++) {
+        if (calls[i] == 0) continue;
+        uint64_t mean = ns[i] / calls[i];
+        json << (first ? "" : ",\n") << "    {\"name\": \"" << COUNTER_NAMES[i] << "\", \"calls\": "
+             << calls[i] << ", \"total_ns\": " << ns[i] << ", \"mean_ns\": " << mean << "}";
+        csv << COUNTER_NAMES[i] << "," << calls[i] << "," << ns[i] << "," << mean << "\n";
+        first = false;
+    }
+    json << "\n  ]\n}\n";
+
+    // Chrome trace-event format: complete ("X") events, times in microseconds
+    ofstream trace = open_report(prefix + ".trace.json");
+    trace << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+    first = true;
+    char buf[160];
+    for (const auto& p : registry) {
+        for (const auto& e : p->events) {
+            snprintf(buf, sizeof buf,
+                     "%s{\"name\": \"%s\", \"cat\": \"sim\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                     "\"pid\": 1, \"tid\": %u}",
+                     first ? "" : ",\n", COUNTER_NAMES[(int)e.counter], e.start_ns / 1000.0,
+                     e.duration_ns / 1000.0, p->tid);
+            trace << buf;
+            first = false;
+        }
+    }
+    trace << "\n]}\n";
+    if (!json || !csv || !trace) throw runtime_error("failed writing profile reports to " + prefix + ".*");
+}
+
+#else
+
+bool profile_enabled() { return false; }
+void profile_record_events(bool) {}
+void profile_reset() {}
+void profile_write_reports(const string&) {}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef PROFILE_HPP_
+#define PROFILE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "trace_compiler.hpp"
+
+// ======================== INSTRUMENTATION ========================
+
+// Hot-path timers, compiled in only with -DSIM_PROFILE (cmake -DSIM_PROFILE=ON,
+// or PROFILE=1 ./build.sh). Without it PROFILE_SCOPE expands to nothing and
+// its argument is never evaluated.
+//
+// Each PROFILE_SCOPE adds its wall-clock time and one call to a counter.
+// Scopes nest, so times are inclusive: op.FORK includes the format.snapshot
+// and alloc.allocate calls it makes.
+
+enum class profile_counter : std::uint8_t {
+    PARSE,               // trace line -> instruction
+    SIMULATE,            // one whole simulation run
+    FORMAT_BOILERPLATE,  // interrupt entry lines
+    FORMAT_SNAPSHOT,     // system status tables
+    WRITE,               // log output reaching the file
+    OP_FORK,             // one per opcode, in opcode order
+    OP_EXEC,
+    OP_CPU,
+    OP_SYSCALL,
+    OP_END_IO,
+    OP_IF_CHILD,
+    OP_IF_PARENT,
+    OP_ENDIF,
+    OP_UNKNOWN,
+    ALLOCATE,
+    FREE,
+    COUNT
+};
+
+const char* profile_counter_name(profile_counter counter);   // "parse", "op.FORK", ...
+
+inline profile_counter opcode_counter(opcode op) {
+    return (profile_counter)((int)profile_counter::OP_FORK + (int)op);
+}
+
+// False when built without SIM_PROFILE; the functions below then do nothing
+bool profile_enabled();
+
+// Also keep every scope as a Chrome trace event (up to MAX_TRACE_EVENTS per thread)
+void profile_record_events(bool on);
+void profile_reset();
+
+// <prefix>.json and <prefix>.csv summaries, <prefix>.trace.json for
+// chrome://tracing / Perfetto. Throws std::runtime_error on I/O errors.
+void profile_write_reports(const std::string& prefix);
+
+constexpr std::size_t MAX_TRACE_EVENTS = 1 << 20;
+
+#ifdef SIM_PROFILE
+
+class profile_scope {
+public:
+    explicit profile_scope(profile_counter counter)
+        : counter(counter), start(std::chrono::steady_clock::now()) {}
+    ~profile_scope();
+    profile_scope(const profile_scope&) = delete;
+    profile_scope& operator=(const profile_scope&) = delete;
+
+private:
+    profile_counter counter;
+    std::chrono::steady_clock::time_point start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(counter) profile_scope PROFILE_CONCAT(profile_scope_, __LINE__)(counter)
+
+#else
+
+#define PROFILE_SCOPE(counter) ((void)0)
+
+#endif
+
+#endif
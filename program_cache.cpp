@@ -0,0 +1,44 @@
+#include "program_cache.hpp"
+#include <sys/stat.h>
+
+using namespace std;
+
+shared_ptr<const compiled_program> program_cache::get(const string& image) {
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = programs.find(image);
+        if (it != programs.end() && (!watch || !it->second.from_file)) return it->second.program;
+    }
+
+    string path = dir + "/" + image + ".txt";
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        lock_guard<mutex> guard(lock);
+        programs.erase(image);   // a watched file that was removed
+        return nullptr;
+    }
+    long long mtime = (long long)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = programs.find(image);
+        if (it != programs.end() && it->second.mtime_ns == mtime && it->second.size == (long long)st.st_size)
+            return it->second.program;
+    }
+
+    // Compile outside the lock; if two threads race, the last insert wins and
+    // both copies are the same file
+    auto program = make_shared<const compiled_program>(compile_program(path));
+    lock_guard<mutex> guard(lock);
+    programs[image] = {program, true, mtime, (long long)st.st_size};
+    return program;
+}
+
+void program_cache::insert(const string& image, shared_ptr<const compiled_program> program) {
+    lock_guard<mutex> guard(lock);
+    programs[image] = {move(program), false, 0, 0};
+}
+
+size_t program_cache::size() const {
+    lock_guard<mutex> guard(lock);
+    return programs.size();
+}
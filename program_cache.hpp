@@ -0,0 +1,49 @@
+#ifndef PROGRAM_CACHE_HPP_
+#define PROGRAM_CACHE_HPP_
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "trace_compiler.hpp"
+
+// ======================== PROGRAM CACHE ========================
+
+// Compiled program files keyed by file stem ("program1_2"). Each file is read
+// and compiled once, then shared by every EXEC in every simulation holding
+// the cache. Safe to use from several threads.
+//
+// With `watch_files`, for caches that outlive their inputs (the server), every
+// hit checks the file's mtime and size and recompiles a file that changed.
+class program_cache {
+public:
+    explicit program_cache(std::string program_dir, bool watch_files = false)
+        : dir(std::move(program_dir)), watch(watch_files) {}
+
+    // nullptr when <program_dir>/<image>.txt does not exist; misses are not
+    // cached, so a file added later is found. Compile errors are thrown as
+    // std::runtime_error (and not cached).
+    std::shared_ptr<const compiled_program> get(const std::string& image);
+
+    // Put an already-compiled program under `image` (e.g. a main trace)
+    void insert(const std::string& image, std::shared_ptr<const compiled_program> program);
+
+    const std::string& directory() const { return dir; }
+    std::size_t size() const;
+
+private:
+    struct entry {
+        std::shared_ptr<const compiled_program> program;
+        bool from_file = false;   // false for insert(): nothing to watch
+        long long mtime_ns = 0;
+        long long size = 0;
+    };
+
+    std::string dir;
+    bool watch;
+    mutable std::mutex lock;
+    std::unordered_map<std::string, entry> programs;
+};
+
+#endif
@@ -0,0 +1,37 @@
+#include "program_catalog.hpp"
+#include "interrupts_101297993_101302793.hpp"
+#include "text_scan.hpp"
+
+using namespace std;
+
+uint64_t program_catalog::hash_name(string_view name) { return fnv1a(name); }
+
+program_catalog::program_catalog(const vector<external_file>& files) {
+    size_t capacity = 16;
+    while (capacity < files.size() * 2) capacity <<= 1;
+    slots.assign(capacity, slot{0, 0});
+    mask = capacity - 1;
+
+    for (const auto& f : files) {
+        if (find(f.program_name)) continue;
+
+        uint32_t id = (uint32_t)entries.size();
+        names.push_back(f.program_name);
+        entries.push_back({id, f.size});
+
+        uint64_t h = hash_name(f.program_name);
+        size_t i = h & mask;
+        while (slots[i].entry != 0) i = (i + 1) & mask;
+        slots[i] = {h, id + 1};
+    }
+}
+
+const program_entry* program_catalog::find(string_view name) const {
+    if (slots.empty()) return nullptr;
+    uint64_t h = hash_name(name);
+    for (size_t i = h & mask; slots[i].entry != 0; i = (i + 1) & mask) {
+        const slot& s = slots[i];
+        if (s.hash == h && names[s.entry - 1] == name) return &entries[s.entry - 1];
+    }
+    return nullptr;
+}
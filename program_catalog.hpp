@@ -0,0 +1,50 @@
+#ifndef PROGRAM_CATALOG_HPP_
+#define PROGRAM_CATALOG_HPP_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct external_file;
+
+// ======================= PROGRAM CATALOG =======================
+
+struct program_entry {
+    std::uint32_t id;     // dense, in external-files order
+    unsigned int size;    // MB
+};
+
+// Immutable name -> program lookup built once from the external files table.
+// Open addressing over a power-of-two slot array; the full hash is kept per
+// slot so a probe only compares strings on a hash match. When a name is
+// listed twice the first entry wins, as get_size() did.
+class program_catalog {
+public:
+    program_catalog() = default;
+    explicit program_catalog(const std::vector<external_file>& files);
+
+    const program_entry* find(std::string_view name) const;
+    unsigned int size_of(std::string_view name) const {
+        const program_entry* e = find(name);
+        return e ? e->size : 0;
+    }
+
+    const std::string& name(std::uint32_t id) const { return names[id]; }
+    std::size_t size() const { return entries.size(); }
+
+private:
+    struct slot {
+        std::uint64_t hash;
+        std::uint32_t entry;   // index + 1, 0 = empty
+    };
+
+    static std::uint64_t hash_name(std::string_view name);
+
+    std::vector<std::string> names;
+    std::vector<program_entry> entries;
+    std::vector<slot> slots;
+    std::size_t mask = 0;
+};
+
+#endif
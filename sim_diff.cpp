@@ -0,0 +1,650 @@
+// Differential check of the simulator engines. Each engine runs the same
+// traces and its logs are compared event by event with simulate_trace, the
+// original string engine, and for the assignment's traces with the logs in
+// output_files/. Stops at the first divergence and prints it with a command
+// that reproduces it. The parallel FORK engine is checked the same way
+// against nested_simulator, on generated program workloads.
+// Usage: sim_diff [--count N] [--from I] [--seed S] [--lines N] [--jobs N]
+//                 [--engines compiled,stream,blocks,delta] [--simd scalar|sse2|avx2]
+//                 [--input DIR] [--expected DIR] [--no-golden] [--save FILE]
+//                 [--nested N]
+#include "sim_runner.hpp"
+#include "parallel_nested.hpp"
+#include "text_scan.hpp"
+#include "thread_pool.hpp"
+#include "workload_gen.hpp"
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+namespace fs = std::filesystem;
+using diff_clock = chrono::steady_clock;
+
+// ===== ENGINES =====
+
+struct diff_case {
+    string name;
+    string text;            // the trace file as it is on disk
+    vector<string> lines;   // getline lines without the empty ones, as main() used to read them
+    const sim_tables* tables;
+    size_t block_limit;     // bytes per block for the "blocks" engine
+};
+
+struct sim_logs {
+    string execution, status;
+    int end_time = 0;
+    string error;   // the engine threw; the logs hold whatever came before
+};
+
+static sim_logs run_reference(const diff_case& c) {
+    sim_logs out;
+    try {
+        simulator_context ctx;
+        PCB init(0, -1, "init", 1, -1);
+        allocate_memory(ctx, &init);
+        tie(out.execution, out.status, out.end_time) =
+            simulate_trace(ctx, c.lines, 0, c.tables->vectors, c.tables->delays, c.tables->catalog, init);
+    } catch (const exception& e) {
+        out.error = e.what();
+    }
+    return out;
+}
+
+static sim_logs run_compiled(const diff_case& c) {
+    sim_logs out;
+    try {
+        simulator_context ctx;
+        PCB init(0, -1, "init", 1, -1);
+        allocate_memory(ctx, &init);
+        string_pool names;
+        compiled_trace trace = compile_trace(c.lines, names);
+        tie(out.execution, out.status, out.end_time) =
+            simulate_compiled(ctx, trace, names, 0, c.tables->vectors, c.tables->delays, c.tables->catalog, init,
+                              &c.tables->timings);
+    } catch (const exception& e) {
+        out.error = e.what();
+    }
+    return out;
+}
+
+// The trace in an anonymous file, so the streaming engines read it through
+// the same mapped reader as a trace on disk
+static unique_ptr<line_reader> memory_file(const string& text) {
+    int fd = memfd_create("sim_diff", 0);
+    if (fd < 0) throw runtime_error("memfd_create failed");
+    for (size_t done = 0; done < text.size();) {
+        ssize_t n = write(fd, text.data() + done, text.size() - done);
+        if (n <= 0) { close(fd); throw runtime_error("write to memfd failed"); }
+        done += (size_t)n;
+    }
+    return make_unique<mapped_line_reader>(fd, text.size());
+}
+
+// Hands out blocks of about `limit` bytes, so short traces still cross
+// block boundaries in the block parser
+class small_block_reader : public line_reader {
+public:
+    small_block_reader(unique_ptr<line_reader> _inner, size_t _limit) : inner(move(_inner)), limit(_limit) {}
+
+    bool next(string_view& line) override {
+        bool more = inner->next(line);
+        lines_read = inner->line_number();
+        return more;
+    }
+    bool next_block(string_view& text, size_t) override {
+        bool more = inner->next_block(text, limit);
+        lines_read = inner->line_number();
+        return more;
+    }
+
+private:
+    unique_ptr<line_reader> inner;
+    size_t limit;
+};
+
+static sim_logs run_streamed(const diff_case& c, line_reader& reader, status_mode status = status_mode::FULL) {
+    sim_logs out;
+    log_sink execLog = log_sink::memory(), sysLog = log_sink::memory();
+    simulator_context ctx;
+    PCB init(0, -1, "init", 1, -1);
+    allocate_memory(ctx, &init);
+    string_pool names;
+    trace_simulator sim(ctx, names, c.tables->dispatch, c.tables->catalog, init, 0, execLog, sysLog, &c.tables->timings,
+                        status);
+    try {
+        simulate_stream(reader, names, sim);
+    } catch (const exception& e) {
+        out.error = e.what();
+    }
+    out.execution = execLog.take();
+    out.status = sysLog.take();
+    out.end_time = sim.time();
+    return out;
+}
+
+static sim_logs run_stream(const diff_case& c) {
+    auto reader = memory_file(c.text);
+    return run_streamed(c, *reader);
+}
+
+static sim_logs run_blocks(const diff_case& c) {
+    small_block_reader reader(memory_file(c.text), c.block_limit);
+    return run_streamed(c, reader);
+}
+
+static sim_logs run_delta(const diff_case& c);
+
+struct engine {
+    const char* name;
+    sim_logs (*run)(const diff_case&);
+    bool rows_by_pid;   // a delta log has no wait queue order, only rows
+};
+
+static const engine ENGINES[] = {
+    {"compiled", run_compiled, false},   // compile_trace + simulate_compiled
+    {"stream", run_stream, false},       // what sim runs: compile_block + trace_simulator
+    {"blocks", run_blocks, false},       // the same with blocks of 1..128 bytes
+    {"delta", run_delta, true},          // stream with --status-delta, replayed
+};
+
+// ===== STRUCTURAL DIFF =====
+
+static vector<string_view> split_lines(string_view text) {
+    vector<string_view> lines;
+    while (!text.empty()) {
+        size_t nl = text.find('\n');
+        lines.push_back(text.substr(0, nl));
+        text.remove_prefix(nl == string_view::npos ? text.size() : nl + 1);
+    }
+    return lines;
+}
+
+static string_view trim(string_view s) {
+    size_t from = s.find_first_not_of(" \t\r");
+    if (from == string_view::npos) return {};
+    return s.substr(from, s.find_last_not_of(" \t\r") - from + 1);
+}
+
+static bool read_number(string_view s, long long& value) {
+    s = trim(s);
+    return !s.empty() && from_chars(s.data(), s.data() + s.size(), value).ptr == s.data() + s.size();
+}
+
+// "<time>, <duration>, <event>" with or without the spaces
+struct log_event {
+    long long time = 0, duration = 0;
+    string_view text;
+};
+
+static bool parse_event(string_view line, log_event& event) {
+    size_t c1 = line.find(','), c2 = c1 == string_view::npos ? c1 : line.find(',', c1 + 1);
+    if (c2 == string_view::npos) return false;
+    event.text = trim(line.substr(c2 + 1));
+    return read_number(line.substr(0, c1), event.time) && read_number(line.substr(c1 + 1, c2 - c1 - 1), event.duration);
+}
+
+// First difference between two execution logs, or "" when they match
+static string diff_execution(string_view expected, string_view actual) {
+    vector<string_view> want = split_lines(expected), got = split_lines(actual);
+    for (size_t i = 0; i < max(want.size(), got.size()); i++) {
+        string where = "execution line " + to_string(i + 1) + ": ";
+        if (i >= got.size()) return where + "log ends early\n    expected: " + string(want[i]);
+        if (i >= want.size()) return where + "extra event\n    actual:   " + string(got[i]);
+        if (want[i] == got[i]) continue;
+
+        log_event a, b;
+        string what = "event differs";
+        if (parse_event(want[i], a) && parse_event(got[i], b)) {
+            if (a.time != b.time) what = "time " + to_string(b.time) + ", expected " + to_string(a.time);
+            else if (a.duration != b.duration) what = "duration " + to_string(b.duration) + ", expected " + to_string(a.duration);
+            else if (a.text == b.text) what = "same event, different spacing";
+        }
+        return where + what + "\n    expected: " + string(want[i]) + "\n    actual:   " + string(got[i]);
+    }
+    return expected == actual ? "" : "execution log: final newline differs";
+}
+
+// The cells of a "| a | b |" table row
+static vector<string_view> table_cells(string_view row) {
+    vector<string_view> cells;
+    for (size_t from = 1, bar; (bar = row.find('|', from)) != string_view::npos; from = bar + 1)
+        cells.push_back(trim(row.substr(from, bar - from)));
+    return cells;
+}
+
+// First difference between two system status logs, named by snapshot
+static string diff_status(string_view expected, string_view actual) {
+    static const char* const COLUMNS[] = {"PID", "program name", "partition number", "size", "state"};
+    vector<string_view> want = split_lines(expected), got = split_lines(actual);
+    size_t snapshot = 0;
+    string_view header;
+    for (size_t i = 0; i < max(want.size(), got.size()); i++) {
+        if (i < want.size() && want[i].rfind("time:", 0) == 0) { snapshot++; header = want[i]; }
+        string where = "status line " + to_string(i + 1) +
+                       (snapshot ? " (snapshot " + to_string(snapshot) + ", " + string(header) + ")" : "") + ": ";
+        if (i >= got.size()) return where + "log ends early\n    expected: " + string(want[i]);
+        if (i >= want.size()) return where + "extra line\n    actual:   " + string(got[i]);
+        if (want[i] == got[i]) continue;
+
+        string what = "line differs";
+        if (want[i].rfind("| ", 0) == 0 && got[i].rfind("| ", 0) == 0) {
+            vector<string_view> a = table_cells(want[i]), b = table_cells(got[i]);
+            for (size_t col = 0; col < min({a.size(), b.size(), size(COLUMNS)}); col++)
+                if (a[col] != b[col]) {
+                    what = string(COLUMNS[col]) + " " + string(b[col]) + ", expected " + string(a[col]);
+                    break;
+                }
+        }
+        return where + what + "\n    expected: " + string(want[i]) + "\n    actual:   " + string(got[i]);
+    }
+    return expected == actual ? "" : "status log: final newline differs";
+}
+
+// ===== DELTA STATUS =====
+
+static string row_text(string_view pid, string_view program, string_view partition, string_view size,
+                       string_view state) {
+    string row = "| ";
+    for (string_view cell : {pid, program, partition, size}) { row += cell; row += " | "; }
+    row += state;
+    row += " |\n";
+    return row;
+}
+
+// A full status log with each snapshot's rows sorted by PID
+static string rows_by_pid(string_view status) {
+    string out;
+    vector<pair<long long, string>> rows;
+    auto flush = [&] {
+        sort(rows.begin(), rows.end());
+        for (const auto& row : rows) out += row.second;
+        rows.clear();
+    };
+    for (string_view line : split_lines(status)) {
+        if (line.rfind("time:", 0) == 0) { flush(); out += line; out += '\n'; continue; }
+        if (line.rfind("| ", 0) != 0) continue;
+        vector<string_view> cells = table_cells(line);
+        long long pid;
+        if (cells.size() != 5 || !read_number(cells[0], pid)) continue;   // the column names
+        rows.emplace_back(pid, row_text(cells[0], cells[1], cells[2], cells[3], cells[4]));
+    }
+    flush();
+    return out;
+}
+
+// A delta status log replayed into the same form: after each header, the
+// whole table in PID order. The program name is whatever lies between the
+// PPID and the last three fields.
+static string replay_delta(string_view status) {
+    string out;
+    map<long long, string> rows;
+    bool started = false;
+    auto flush = [&] {
+        if (started)
+            for (const auto& row : rows) out += row.second;
+    };
+    for (string_view line : split_lines(status)) {
+        if (line.empty()) continue;
+        if (line.rfind("time:", 0) == 0) { flush(); started = true; out += line; out += '\n'; continue; }
+
+        vector<string_view> head, tail;   // fields from the left / from the right
+        string_view rest = line.substr(min<size_t>(2, line.size()));
+        for (int i = 0; i < 2 && !rest.empty(); i++) {
+            size_t sp = rest.find(' ');
+            head.push_back(rest.substr(0, sp));
+            rest = sp == string_view::npos ? string_view() : rest.substr(sp + 1);
+        }
+        for (int i = 0; i < 3 && head.size() == 2; i++) {
+            size_t sp = rest.rfind(' ');
+            if (sp == string_view::npos) break;
+            tail.push_back(rest.substr(sp + 1));
+            rest = rest.substr(0, sp);
+        }
+        long long pid;
+        if (line.rfind("- ", 0) == 0 && read_number(line.substr(2), pid)) rows.erase(pid);
+        else if (line.rfind("+ ", 0) == 0 && tail.size() == 3 && read_number(head[0], pid))
+            rows[pid] = row_text(head[0], rest, tail[2], tail[1], tail[0]);
+        else out += "bad delta line: " + string(line) + "\n";
+    }
+    flush();
+    return out;
+}
+
+static sim_logs run_delta(const diff_case& c) {
+    auto reader = memory_file(c.text);
+    sim_logs out = run_streamed(c, *reader, status_mode::DELTA);
+    out.status = replay_delta(out.status);
+    return out;
+}
+
+static string diff_logs(const sim_logs& expected, const sim_logs& actual) {
+    if (!expected.error.empty() || !actual.error.empty()) {
+        if (expected.error.empty()) return "threw: " + actual.error;
+        if (actual.error.empty()) return "ran, but the reference threw: " + expected.error;
+        return "";   // both rejected the trace
+    }
+    string d = diff_execution(expected.execution, actual.execution);
+    if (d.empty()) d = diff_status(expected.status, actual.status);
+    if (d.empty() && expected.end_time != actual.end_time)
+        d = "end time " + to_string(actual.end_time) + ", expected " + to_string(expected.end_time);
+    return d;
+}
+
+// ===== CORPUS =====
+
+// Tables for the generated traces: every vector and device exists, and the
+// sizes cover the smallest partition up to ones that can never fit twice.
+// The fixed timings are the input directory's, which must reproduce the
+// special cases simulate_trace hardcodes.
+static sim_tables corpus_tables(const string& inputDir) {
+    vector<string> vectors;
+    for (int i = 0; i < 26; i++) vectors.push_back("0X0" + to_string(100 + i));
+    vector<int> delays;
+    for (int i = 0; i < 20; i++) delays.push_back(50 + 37 * i % 300);
+    program_catalog catalog({{"program1", 10}, {"program2", 15}, {"program3", 2}, {"program4", 25}, {"program5", 40}});
+    dispatch_table dispatch(vectors, delays, isr_cost_model{});
+    return {vectors, delays, catalog, dispatch, load_fixed_timings(inputDir + "/fixed_timings.txt")};
+}
+
+// Trace `index` of the corpus. Besides ordinary lines it has what the
+// parsers treat specially: Test 2's FORK 17 and EXEC operands, spacing and
+// signs around the operand, EXEC name spellings, unknown and malformed lines,
+// CRLF endings and blank lines.
+static string generate_case(uint64_t seed, uint64_t index, unsigned max_lines) {
+    seed_seq seq{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)index, (uint32_t)(index >> 32)};
+    mt19937 rng(seq);
+    auto pick = [&rng](int n) { return (int)(rng() % (unsigned)n); };
+    static const char* const SEPARATORS[] = {", ", ",", " , ", ",\t", ",  "};
+    static const char* const BLOCKS[] = {"IF_CHILD", "IF_PARENT", "ENDIF"};
+    static const int SPECIAL[] = {16, 25, 33, 50};
+
+    unsigned lines = 1 + pick((int)max_lines);
+    string out;
+    for (unsigned i = 0; i < lines; i++) {
+        string op, operand;
+        int r = pick(100);
+        if (r < 30) { op = "CPU"; operand = to_string(1 + pick(200)); }
+        else if (r < 45) { op = "SYSCALL"; operand = to_string(pick(26)); }
+        else if (r < 58) { op = "END_IO"; operand = to_string(pick(26)); }
+        else if (r < 73) { op = BLOCKS[pick(3)]; operand = "0"; }
+        else if (r < 81) { op = "FORK"; operand = to_string(pick(8) == 0 ? 17 : 8 + pick(8)); }
+        else if (r < 93) {
+            string program = "program" + to_string(1 + pick(6));   // program6 is not in the catalog
+            switch (pick(6)) {
+                case 0: op = "EXEC " + program; break;
+                case 1: op = "EXEC_" + program; break;
+                case 2: op = "EXEC" + program + "_3"; break;
+                default: op = "EXEC " + program + "_" + to_string(1 + pick(5)); break;
+            }
+            operand = to_string(pick(2) ? SPECIAL[pick(4)] : 1 + pick(80));
+        } else if (r < 96) { op = pick(2) ? "BOGUS" : "cpu"; operand = to_string(pick(10)); }
+        else if (r < 98) { out += pick(2) ? "just words" : "CPU, 5, 7"; out += '\n'; continue; }
+        else { out += '\n'; continue; }
+
+        // Spacing the legacy parser strips: inside the keyword, before the
+        // keyword, and signs or zeros on the operand
+        if (pick(20) == 0 && op.size() > 2) op.insert(1 + pick((int)op.size() - 1), " ");
+        if (pick(20) == 0) op = " " + op;
+        if (pick(20) == 0) operand = (pick(2) ? "+" : "00") + operand;
+        out += op + SEPARATORS[pick(5)] + operand;
+        if (pick(30) == 0) out += '\r';
+        out += '\n';
+    }
+    if (pick(4) == 0 && !out.empty()) out.pop_back();   // no final newline
+    return out;
+}
+
+static diff_case make_case(string name, string text, const sim_tables& tables, size_t block_limit) {
+    diff_case c{move(name), move(text), {}, &tables, block_limit};
+    istringstream in(c.text);
+    for (string line; getline(in, line);)
+        if (!line.empty()) c.lines.push_back(line);
+    return c;
+}
+
+// ===== NESTED ENGINES =====
+
+// --exec-programs on a workload directory: nested_simulator, or with `pool`
+// the parallel engine splitting at every FORK so the merge is always used
+static sim_logs run_nested(const string& dir, const string& trace, thread_pool* pool, size_t* branches = nullptr) {
+    sim_logs out;
+    log_sink exec_log = log_sink::memory(), sys_log = log_sink::memory();
+    try {
+        const sim_tables tables = load_tables(trace, dir, isr_cost_model{});
+        program_cache cache(dir);
+        simulator_context ctx;
+        PCB init(0, -1, "init", 1, -1);
+        allocate_memory(ctx, &init);
+        auto program = make_shared<const compiled_program>(compile_program(trace));
+        if (pool) {
+            parallel_nested_simulator sim(ctx, cache, tables.catalog, tables.dispatch, exec_log, sys_log,
+                                          status_mode::FULL, *pool);
+            sim.split_every_fork(true);
+            out.end_time = sim.run(program, init);
+            if (branches) *branches = sim.ran_serially() ? 0 : sim.branches();
+        } else {
+            nested_simulator sim(ctx, cache, tables.catalog, tables.dispatch, exec_log, sys_log);
+            out.end_time = sim.run(program, init);
+        }
+    } catch (const exception& e) {
+        out.error = e.what();
+    }
+    out.execution = exec_log.take();
+    out.status = sys_log.take();
+    return out;
+}
+
+// Workload `index` of the nested corpus: small partitions-to-program ratios
+// so some FORKs and EXECs fail, and deep or wide fork trees
+static workload_spec nested_spec(uint64_t seed, uint64_t index) {
+    seed_seq seq{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)index, (uint32_t)(index >> 32), 0x6e6573u};
+    mt19937 rng(seq);
+    workload_spec spec;
+    spec.seed = rng();
+    spec.lines = 10 + rng() % 200;
+    spec.fork_rate = 0.02 + (rng() % 30) / 100.0;
+    spec.fork_depth = 1 + rng() % 4;
+    spec.exec_fanout = 1 + rng() % 3;
+    spec.programs = spec.fork_depth + 1 + rng() % 6;
+    spec.program_lines = 2 + rng() % 10;
+    spec.max_size = 2 + rng() % 40;
+    spec.sizes = rng() % 2 ? size_distribution::SKEWED : size_distribution::UNIFORM;
+    return spec;
+}
+
+// ===== DRIVER =====
+
+struct diff_failure {
+    uint64_t index = UINT64_MAX;   // corpus position, UINT64_MAX for a golden trace
+    string name, report, text;
+};
+
+static string read_file(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) throw runtime_error("cannot open " + path);
+    return string(istreambuf_iterator<char>(in), {});
+}
+
+// Runs every engine on `c`; returns the first divergence from the reference
+static string check_case(const diff_case& c, const vector<const engine*>& engines, const sim_logs* golden) {
+    sim_logs reference = run_reference(c);
+    if (golden) {
+        sim_logs expected = *golden;
+        expected.end_time = reference.end_time;   // not in the logs
+        string d = diff_logs(expected, reference);
+        if (!d.empty()) return "reference vs expected output: " + d;
+    }
+    for (const engine* e : engines) {
+        sim_logs expected = reference;
+        if (e->rows_by_pid) expected.status = rows_by_pid(reference.status);
+        string d = diff_logs(expected, e->run(c));
+        if (!d.empty()) return string(e->name) + " vs reference: " + d;
+    }
+    return "";
+}
+
+int main(int argc, char** argv) {
+    uint64_t count = 100000, from = 0, seed = 1;
+    unsigned maxLines = 48, jobs = 0;
+    uint64_t nestedCount = 200;
+    string inputDir = "input_files", expectedDir = "output_files", savePath;
+    bool golden = true;
+    vector<const engine*> engines;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--count" && has_value) count = stoull(argv[++i]);
+            else if (arg == "--from" && has_value) from = stoull(argv[++i]);
+            else if (arg == "--seed" && has_value) seed = stoull(argv[++i]);
+            else if (arg == "--lines" && has_value) maxLines = (unsigned)max(1ul, stoul(argv[++i]));
+            else if (arg == "--jobs" && has_value) jobs = (unsigned)stoul(argv[++i]);
+            else if (arg == "--input" && has_value) inputDir = argv[++i];
+            else if (arg == "--expected" && has_value) expectedDir = argv[++i];
+            else if (arg == "--no-golden") golden = false;
+            else if (arg == "--save" && has_value) savePath = argv[++i];
+            else if (arg == "--nested" && has_value) nestedCount = stoull(argv[++i]);
+            else if (arg == "--simd" && has_value) {
+                string name = argv[++i];
+                simd_level level = name == "avx2" ? simd_level::AVX2 : name == "sse2" ? simd_level::SSE2 : simd_level::SCALAR;
+                if (name != simd_level_name(level) || simd_select(level) != level) {
+                    cerr << "SIMD level " << name << " is not available here\n";
+                    return 1;
+                }
+            } else if (arg == "--engines" && has_value) {
+                for (const string& name : split_delim(argv[++i], ",")) {
+                    auto it = find_if(begin(ENGINES), end(ENGINES), [&](const engine& e) { return name == e.name; });
+                    if (it == end(ENGINES)) { cerr << "Unknown engine: " << name << " (compiled, stream, blocks, delta)\n"; return 1; }
+                    engines.push_back(&*it);
+                }
+            } else {
+                cerr << "Unknown option: " << arg << endl;
+                return 1;
+            }
+        }
+    } catch (const logic_error&) {
+        cerr << "Invalid number in the arguments\n";
+        return 1;
+    }
+    if (engines.empty())
+        for (const engine& e : ENGINES) engines.push_back(&e);
+
+    cout << "engines:";
+    for (const engine* e : engines) cout << " " << e->name;
+    cout << " (reference: simulate_trace, scanning: " << simd_level_name(simd_active()) << ")\n";
+
+    diff_failure failure;
+    auto start = diff_clock::now();
+
+    // The assignment's traces, against the checked-in logs as well
+    size_t goldenCount = 0;
+    if (golden) {
+        for (int n = 1; n <= 5; n++) {
+            string tracePath = inputDir + "/trace_" + to_string(n) + ".txt";
+            if (!fs::exists(tracePath)) continue;
+            const sim_tables tables = load_tables(tracePath, inputDir, isr_cost_model{});
+            diff_case c = make_case(tracePath, read_file(tracePath), tables, 1 + n * 7);
+            sim_logs expected;
+            expected.execution = read_file(expectedDir + "/execution_" + to_string(n) + ".txt");
+            expected.status = read_file(expectedDir + "/system_status_" + to_string(n) + ".txt");
+            goldenCount++;
+            string d = check_case(c, engines, &expected);
+            if (!d.empty()) {
+                failure = {UINT64_MAX, tracePath, d, c.text};
+                break;
+            }
+        }
+    }
+
+    // The generated corpus, a chunk of traces per task. The lowest failing
+    // index wins so the report does not depend on the thread count.
+    const sim_tables tables = corpus_tables(inputDir);
+    atomic<uint64_t> firstBad{UINT64_MAX};
+    atomic<uint64_t> checked{0}, traceLines{0};
+    mutex failureLock;
+    if (failure.report.empty()) {
+        const uint64_t CHUNK = 256;
+        thread_pool pool(jobs);
+        for (uint64_t chunk = from; chunk < from + count; chunk += CHUNK) {
+            pool.submit([&, chunk] {
+                uint64_t lines = 0, done = 0;
+                for (uint64_t i = chunk; i < min(chunk + CHUNK, from + count) && i < firstBad; i++) {
+                    diff_case c = make_case("corpus #" + to_string(i), generate_case(seed, i, maxLines), tables,
+                                            1 + i % 128);
+                    lines += c.lines.size();
+                    done++;
+                    string d = check_case(c, engines, nullptr);
+                    if (d.empty()) continue;
+                    lock_guard<mutex> hold(failureLock);
+                    if (i < firstBad) {
+                        firstBad = i;
+                        failure = {i, c.name, d, c.text};
+                    }
+                }
+                checked += done;
+                traceLines += lines;
+            });
+        }
+        pool.wait();
+    }
+
+    // The parallel FORK engine against nested_simulator: the assignment's
+    // traces with their program files, then generated workloads. One at a
+    // time, since each run spreads its own subtrees over the pool.
+    uint64_t nestedChecked = 0;
+    size_t nestedBranches = 0;
+    if (failure.report.empty() && (golden || nestedCount > 0)) {
+        thread_pool forkPool(jobs);
+        auto check_nested = [&](const string& dir, const string& trace) {
+            size_t branches = 0;
+            string d = diff_logs(run_nested(dir, trace, nullptr), run_nested(dir, trace, &forkPool, &branches));
+            nestedChecked++;
+            nestedBranches += branches;
+            return d.empty() ? d : "parallel vs nested: " + d;
+        };
+        for (int n = 1; golden && n <= 5 && failure.report.empty(); n++) {
+            string tracePath = inputDir + "/trace_" + to_string(n) + ".txt";
+            if (!fs::exists(tracePath)) continue;
+            string d = check_nested(inputDir, tracePath);
+            if (!d.empty()) failure = {UINT64_MAX, tracePath + " (--exec-programs)", d, ""};
+        }
+
+        fs::path root = fs::temp_directory_path() / ("sim_diff_" + to_string(getpid()));
+        for (uint64_t i = 0; i < nestedCount && failure.report.empty(); i++) {
+            string dir = (root / to_string(i)).string();
+            fs::create_directories(dir);
+            generate_workload(nested_spec(seed, i), dir);
+            string d = check_nested(dir, dir + "/trace_1.txt");
+            if (d.empty()) fs::remove_all(dir);
+            else failure = {UINT64_MAX, "nested workload #" + to_string(i) + " (kept in " + dir + ")", d, ""};
+        }
+        if (failure.report.empty()) fs::remove_all(root);
+    }
+    double secs = chrono::duration<double>(diff_clock::now() - start).count();
+
+    cout << "checked " << goldenCount << " golden traces and " << checked << " generated traces ("
+         << traceLines << " lines) in " << fixed << setprecision(2) << secs << " s\n";
+    if (nestedChecked)
+        cout << "checked " << nestedChecked << " program workloads on the parallel FORK engine ("
+             << nestedBranches << " branches)\n";
+    if (failure.report.empty()) {
+        cout << "all engines match\n";
+        return 0;
+    }
+
+    cout << "DIVERGENCE in " << failure.name << "\n  " << failure.report << "\n";
+    if (failure.index != UINT64_MAX)
+        cout << "  reproduce: sim_diff --no-golden --seed " << seed << " --lines " << maxLines << " --from "
+             << failure.index << " --count 1\n";
+    if (!savePath.empty() && !failure.text.empty()) {
+        ofstream(savePath, ios::binary) << failure.text;
+        cout << "  trace saved to " << savePath << "\n";
+    }
+    return 1;
+}
@@ -0,0 +1,193 @@
+#include "sim_runner.hpp"
+#include "nested_simulator.hpp"
+#include "parallel_nested.hpp"
+#include "checkpoint.hpp"
+#include <filesystem>
+
+using namespace std;
+namespace fs = std::filesystem;
+
+string resolve_path(const string& base_dir, const string& path) {
+    if (base_dir.empty() || path.empty() || path == "-" || fs::path(path).is_absolute()) return path;
+    return (fs::path(base_dir) / path).string();
+}
+
+bool parse_sim_options(vector<string>& args, sim_options& options, string& error, const string& base_dir) {
+    vector<string> rest;
+    string isrCostFile;
+    for (size_t i = 0; i < args.size(); i++) {
+        const string& arg = args[i];
+        bool has_value = i + 1 < args.size();
+        try {
+            if (arg == "--no-log") options.logging = false;
+            else if (arg == "--exec-programs") options.exec_programs = true;
+            else if (arg == "--policy" && has_value) {
+                if (!parse_policy(args[++i], options.policy)) {
+                    error = "Unknown placement policy: " + args[i] + " (legacy, first, best, worst)";
+                    return false;
+                }
+            } else if (arg == "--partitions" && has_value) {
+                // Either inline sizes or a file; only a file that exists is resolved
+                string spec = args[++i], file = resolve_path(base_dir, spec);
+                try {
+                    options.partition_sizes = parse_partition_sizes(fs::exists(file) ? file : spec);
+                } catch (const exception& e) {
+                    error = string("Invalid partition table: ") + e.what();
+                    return false;
+                }
+            } else if (arg == "--event-engine") options.event_driven = true;
+            else if (arg == "--status-delta") options.status = status_mode::DELTA;
+            else if (arg == "--fork-jobs" && has_value) {
+                options.exec_programs = true;
+                options.fork_jobs = (unsigned)stoul(args[++i]);
+            }
+            else if (arg == "--scheduler" && has_value) {
+                options.event_driven = true;
+                if (!parse_scheduler(args[++i], options.events.scheduler)) {
+                    error = "Unknown scheduler: " + args[i] + " (fcfs, rr, priority)";
+                    return false;
+                }
+            } else if (arg == "--quantum" && has_value) {
+                options.event_driven = true;
+                options.events.quantum = stoi(args[++i]);
+            } else if (arg == "--context-save" && has_value) options.costs.defaults.context_save = stoi(args[++i]);
+            else if (arg == "--load-rate" && has_value) options.costs.load_rate = stoi(args[++i]);
+            else if (arg == "--isr-costs" && has_value) isrCostFile = resolve_path(base_dir, args[++i]);
+            else if (arg == "--checkpoint-every" && has_value) options.checkpoint_lines = stoull(args[++i]);
+            else if (arg == "--checkpoint-time" && has_value) options.checkpoint_time = stoll(args[++i]);
+            else if (arg == "--checkpoint-dir" && has_value) options.checkpoint_dir = resolve_path(base_dir, args[++i]);
+            else if (arg == "--resume-from" && has_value) options.resume_from = resolve_path(base_dir, args[++i]);
+            else rest.push_back(arg);
+        } catch (const logic_error&) {   // stoi and friends
+            error = "Invalid value for " + arg + ": " + args[i];
+            return false;
+        }
+    }
+
+    // Per-vector overrides start from the --context-save default
+    if (!isrCostFile.empty()) {
+        try {
+            int loadRate = options.costs.load_rate;
+            options.costs = load_isr_costs(isrCostFile, options.costs.defaults);
+            options.costs.load_rate = loadRate;
+        } catch (const exception& e) {
+            error = string("Invalid ISR cost table: ") + e.what();
+            return false;
+        }
+    }
+    args = move(rest);
+    return true;
+}
+
+sim_tables load_tables(const string& tracePath, const string& inputDir, const isr_cost_model& costs) {
+    // Define configuration files
+    string vecFile = inputDir + "/vector_table.txt";
+    string devFile = inputDir + "/device_table.txt";
+    string extFile = inputDir + "/external_files.txt";
+
+    // Proper C++ way to simulate argv array
+    std::vector<char*> argvVec;
+    argvVec.push_back((char*)"sim");
+    argvVec.push_back((char*)tracePath.c_str());
+    argvVec.push_back((char*)vecFile.c_str());
+    argvVec.push_back((char*)devFile.c_str());
+    argvVec.push_back((char*)extFile.c_str());
+
+    // Parse configuration files
+    auto [vectors, delays, catalog] =
+        parse_args(static_cast<int>(argvVec.size()), argvVec.data());
+    dispatch_table dispatch(vectors, delays, costs);
+    try {
+        return {vectors, delays, catalog, dispatch, load_fixed_timings(inputDir + "/fixed_timings.txt")};
+    } catch (const runtime_error& e) {
+        cerr << e.what() << endl;
+        exit(1);
+    }
+}
+
+sim_tables read_tables(const string& inputDir, const isr_cost_model& costs) {
+    auto [vectors, delays, catalog] = load_table_files((inputDir + "/vector_table.txt").c_str(),
+                                                       (inputDir + "/device_table.txt").c_str(),
+                                                       (inputDir + "/external_files.txt").c_str());
+    dispatch_table dispatch(vectors, delays, costs);
+    return {vectors, delays, catalog, dispatch, load_fixed_timings(inputDir + "/fixed_timings.txt")};
+}
+
+bool run_simulation(const string& tracePath, const sim_tables& tables,
+                    log_sink& execLog, log_sink& sysLog, const sim_options& options,
+                    program_cache& cache, string& error) {
+    try {
+        simulator_context ctx(options.partition_sizes, options.policy);
+        PCB current(0, -1, "init", 1, -1);
+        if (!allocate_memory(ctx, &current)) {
+            error = "ERROR! Memory allocation failed!";
+            return false;
+        }
+
+        if (options.event_driven) {
+            auto program = make_shared<const compiled_program>(compile_program(tracePath));
+            event_config config = options.events;
+            config.status = options.status;
+            event_engine engine(ctx, cache, tables.catalog, tables.dispatch, config, execLog, sysLog);
+            engine.run(program, current);
+            execLog.flush();
+            sysLog.flush();
+            return true;
+        }
+
+        if (options.exec_programs) {
+            auto program = make_shared<const compiled_program>(compile_program(tracePath));
+            if (options.fork_jobs != 1) {
+                thread_pool pool(options.fork_jobs);
+                parallel_nested_simulator sim(ctx, cache, tables.catalog, tables.dispatch, execLog, sysLog,
+                                              options.status, pool);
+                sim.run(program, current);
+            } else {
+                nested_simulator sim(ctx, cache, tables.catalog, tables.dispatch, execLog, sysLog, options.status);
+                sim.run(program, current);
+            }
+            execLog.flush();
+            sysLog.flush();
+            return true;
+        }
+
+        //  Run the simulation, compiling and executing the trace as it is read
+        auto reader = line_reader::open(tracePath);
+        string_pool names;
+        trace_simulator sim(ctx, names, tables.dispatch, tables.catalog, current, 0, execLog, sysLog, &tables.timings,
+                            options.status);
+        checkpoint_schedule checkpoints(options.checkpoint_dir, options.checkpoint_lines,
+                                        options.checkpoint_time, tracePath);
+        if (!options.resume_from.empty()) {
+            // Lines before the checkpoint are skipped unread by the simulator
+            shared_ptr<const checkpoint> resume = options.resume_state;
+            if (!resume) resume = make_shared<const checkpoint>(read_checkpoint(options.resume_from));
+            const checkpoint& state = *resume;
+            check_trace(state, tracePath);
+            sim.restore(state);
+            string_view skipped;
+            while (reader->line_number() < state.line && reader->next(skipped)) {}
+            if (reader->line_number() < state.line)
+                throw runtime_error("trace ends before line " + to_string(state.line) + " of the checkpoint");
+            checkpoints.start_at(state.line, state.time);
+        }
+        simulate_stream(*reader, names, sim, checkpoints.enabled() ? &checkpoints : nullptr);
+    } catch (const exception& e) {
+        error = "Error: " + tracePath + ": " + e.what();
+        return false;
+    }
+    return true;
+}
+
+bool run_simulation(const string& tracePath, const sim_tables& tables,
+                    const string& execOut, const string& sysOut, const sim_options& options,
+                    program_cache& cache, string& error) {
+    try {
+        log_sink execLog = options.logging ? log_sink::to_file(execOut) : log_sink::discard();
+        log_sink sysLog = options.logging ? log_sink::to_file(sysOut) : log_sink::discard();
+        return run_simulation(tracePath, tables, execLog, sysLog, options, cache, error);
+    } catch (const exception& e) {
+        error = "Error: " + tracePath + ": " + e.what();
+        return false;
+    }
+}
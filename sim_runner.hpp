@@ -0,0 +1,77 @@
+#ifndef SIM_RUNNER_HPP_
+#define SIM_RUNNER_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "interrupts_101297993_101302793.hpp"
+#include "event_engine.hpp"
+#include "program_cache.hpp"
+
+// ======================== SIMULATION RUNS ========================
+
+// Parsed vector / device / external-file tables, shared read-only by every run
+struct sim_tables {
+    std::vector<std::string> vectors;
+    std::vector<int> delays;
+    program_catalog catalog;
+    dispatch_table dispatch;   // vectors + delays compiled for the simulators
+    fixed_timings timings;     // <input_dir>/fixed_timings.txt, for the default engine
+};
+
+// Command-line settings that apply to every simulation
+struct sim_options {
+    bool logging = true;
+    bool exec_programs = false;   // run EXEC'd program files for real (nested_simulator)
+    unsigned fork_jobs = 1;       // with exec_programs: threads for FORK subtrees, 0 = one per core
+    bool event_driven = false;    // concurrent processes on the discrete-event engine
+    status_mode status = status_mode::FULL;
+    event_config events;
+    placement_policy policy = placement_policy::LEGACY;
+    std::vector<unsigned> partition_sizes = partition_manager::default_sizes();
+    isr_cost_model costs;   // kernel-entry timings, per interrupt vector
+    // Streaming engine only: periodic checkpoints, and a checkpoint to resume from
+    std::uint64_t checkpoint_lines = 0;
+    long long checkpoint_time = 0;
+    std::string checkpoint_dir = "checkpoints";
+    std::string resume_from;
+    std::shared_ptr<const checkpoint> resume_state;   // resume_from, when the caller has read it already
+
+    bool checkpointing() const { return checkpoint_lines > 0 || checkpoint_time > 0 || !resume_from.empty(); }
+};
+
+// Moves the simulation flags (--no-log, --exec-programs, --policy P,
+// --partitions SIZES, --event-engine, --scheduler S, --quantum N,
+// --status-delta, --fork-jobs N, --context-save N, --load-rate N, --isr-costs FILE,
+// --checkpoint-every N, --checkpoint-time T, --checkpoint-dir DIR,
+// --resume-from FILE) out of `args` into `options`, leaving everything else
+// in order. Relative paths are taken from `base_dir` when it is not empty.
+// Returns false with `error` set on a bad value.
+bool parse_sim_options(std::vector<std::string>& args, sim_options& options, std::string& error,
+                       const std::string& base_dir = "");
+
+// `path` relative to `base_dir` ("" and "-" stay as they are)
+std::string resolve_path(const std::string& base_dir, const std::string& path);
+
+// Reads <input_dir>/{vector_table,device_table,external_files}.txt and the
+// optional fixed_timings.txt. parse_args exits on a missing table, and so
+// does this on bad fixed timings; callers that must not exit use read_tables.
+sim_tables load_tables(const std::string& trace_path, const std::string& input_dir, const isr_cost_model& costs);
+// load_tables that throws runtime_error instead of exiting
+sim_tables read_tables(const std::string& input_dir, const isr_cost_model& costs);
+
+// Run one trace (a file path, or "-" for stdin). Every run gets a fresh
+// simulator_context, so runs are independent and can share `tables` and
+// `cache` across threads. With --exec-programs or the event engine,
+// compiled program files come from `cache`. Returns false with `error` set.
+bool run_simulation(const std::string& trace_path, const sim_tables& tables,
+                    log_sink& exec_log, log_sink& sys_log, const sim_options& options,
+                    program_cache& cache, std::string& error);
+
+// Same, streaming the logs to files (or nowhere without logging)
+bool run_simulation(const std::string& trace_path, const sim_tables& tables,
+                    const std::string& exec_out, const std::string& sys_out, const sim_options& options,
+                    program_cache& cache, std::string& error);
+
+#endif
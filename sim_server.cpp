@@ -0,0 +1,302 @@
+#include "sim_server.hpp"
+#include "sim_runner.hpp"
+#include "checkpoint.hpp"
+#include "thread_pool.hpp"
+#include "text_scan.hpp"
+#include <atomic>
+#include <csignal>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <sys/socket.h>
+#include <sys/un.h>
+using namespace std;
+namespace fs = std::filesystem;
+
+// ===== WARM STATE =====
+
+// Tables and compiled programs for one input directory, kept between jobs
+struct warm_input {
+    sim_tables tables;
+    program_cache cache;
+    vector<fs::file_time_type> stamps;   // of the table files when loaded
+
+    warm_input(sim_tables t, const string& dir, vector<fs::file_time_type> s)
+        : tables(move(t)), cache(dir, true), stamps(move(s)) {}
+};
+
+static const char* TABLE_FILES[] = {"vector_table.txt", "device_table.txt", "external_files.txt"};
+
+class warm_store {
+public:
+    explicit warm_store(isr_cost_model c) : costs(move(c)) {}
+
+    // Loads `dir` on first use and again whenever a table file has changed.
+    // Jobs already running keep the copy they were given.
+    shared_ptr<warm_input> get(const string& dir, string& error) {
+        vector<fs::file_time_type> stamps;
+        for (const char* name : TABLE_FILES) {
+            error_code ec;
+            string path = dir + "/" + name;
+            auto stamp = fs::last_write_time(path, ec);
+            if (ec || !fs::is_regular_file(path)) {
+                error = "Cannot open " + path;
+                return nullptr;
+            }
+            stamps.push_back(stamp);
+        }
+        error_code ec;   // optional; a missing file stamps as file_time_type::min()
+        stamps.push_back(fs::last_write_time(dir + "/fixed_timings.txt", ec));
+
+        lock_guard<mutex> guard(lock);
+        auto& slot = inputs[dir];
+        if (!slot || slot->stamps != stamps) {
+            // A table can still vanish between the stamps and the read
+            try {
+                slot = make_shared<warm_input>(read_tables(dir, costs), dir, move(stamps));
+            } catch (const exception& e) {
+                if (!slot) inputs.erase(dir);
+                error = e.what();
+                return nullptr;
+            }
+        }
+        return slot;
+    }
+
+    size_t directories() const {
+        lock_guard<mutex> guard(lock);
+        return inputs.size();
+    }
+
+    size_t programs() const {
+        lock_guard<mutex> guard(lock);
+        size_t n = 0;
+        for (const auto& [dir, input] : inputs) n += input->cache.size();
+        return n;
+    }
+
+private:
+    isr_cost_model costs;   // the server's; jobs with other costs rebuild the dispatch table
+    mutable mutex lock;
+    map<string, shared_ptr<warm_input>> inputs;
+};
+
+// ===== CONNECTIONS =====
+
+static void send_frame(int fd, char tag, string_view payload) { log_sink::write_frame(fd, tag, payload); }
+
+// Listening socket, for the signal handlers and --shutdown
+static atomic<int> listen_fd{-1};
+static atomic<bool> stopping{false};
+
+static void request_stop() {
+    stopping = true;
+    int fd = listen_fd;
+    if (fd >= 0) shutdown(fd, SHUT_RDWR);   // wakes accept(); async-signal-safe
+}
+
+extern "C" void on_stop_signal(int) { request_stop(); }
+
+struct server_state {
+    warm_store store;
+    string default_input;
+    const sim_options& defaults;
+    atomic<size_t> served{0}, failed{0};
+};
+
+// Runs one job's arguments; console text goes to `out`, errors to `error`
+static int run_job(int fd, vector<string> args, const string& cwd, server_state& server,
+                   string& out, string& error) {
+    if (args.size() == 1 && args[0] == "--shutdown") {
+        request_stop();
+        out = "Server stopping\n";
+        return 0;
+    }
+    if (args.size() == 1 && args[0] == "--stats") {
+        out = "Jobs served: " + to_string(server.served) + " (" + to_string(server.failed) + " failed)\n"
+              "Cached input directories: " + to_string(server.store.directories()) + "\n"
+              "Cached programs: " + to_string(server.store.programs()) + "\n";
+        return 0;
+    }
+
+    sim_options options = server.defaults;
+    if (!parse_sim_options(args, options, error, cwd)) return 1;
+
+    string inputDir = server.default_input;
+    vector<string> rest;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--input" && i + 1 < args.size()) inputDir = resolve_path(cwd, args[++i]);
+        else if (args[i].rfind("--", 0) == 0) {
+            error = "Not available on the server: " + args[i] + " (sim [options] <trace> [execution_out] [status_out])";
+            return 1;
+        } else rest.push_back(args[i]);
+    }
+    if (rest.empty() || rest.size() > 3) {
+        error = "Usage: [options] <trace> [execution_out|-] [status_out|-]";
+        return 1;
+    }
+    if (rest[0] == "-") {
+        error = "The server cannot read a trace from stdin; pass a file";
+        return 1;
+    }
+    if (options.checkpointing() && (options.exec_programs || options.event_driven)) {
+        error = "Checkpoints need a single trace on the default engine (sim [options] <trace>)";
+        return 1;
+    }
+
+    string tracePath = resolve_path(cwd, rest[0]);
+    string outputDir = resolve_path(cwd, "output_files");
+    string execOut = rest.size() > 1 ? resolve_path(cwd, rest[1]) : outputDir + "/execution.txt";
+    string sysOut = rest.size() > 2 ? resolve_path(cwd, rest[2]) : outputDir + "/system_status.txt";
+
+    if (!options.resume_from.empty()) {
+        try {
+            options.resume_state = make_shared<const checkpoint>(read_checkpoint(options.resume_from));
+            const checkpoint& state = *options.resume_state;
+            send_frame(fd, sim_protocol::OUT,
+                       "Resuming at line " + to_string(state.line) + ", time " + to_string(state.time) +
+                       "; the logs continue the full run's from byte " + to_string(state.exec_bytes) +
+                       " (execution) and " + to_string(state.sys_bytes) + " (status)\n");
+        } catch (const exception& e) {
+            error = string("Error: ") + e.what();
+            return 1;
+        }
+    }
+
+    shared_ptr<warm_input> input = server.store.get(inputDir, error);
+    if (!input) return 1;
+
+    // The warm dispatch table is compiled with the server's costs
+    const sim_tables* tables = &input->tables;
+    optional<sim_tables> retimed;
+    if (options.costs != server.defaults.costs) {
+        retimed.emplace(input->tables);
+        retimed->dispatch = dispatch_table(retimed->vectors, retimed->delays, options.costs);
+        tables = &*retimed;
+    }
+
+    try {
+        auto open_log = [&](const string& path, char tag) {
+            if (!options.logging) return log_sink::discard();
+            if (path == "-") return log_sink::to_frames(fd, tag);
+            if (fs::path(path).has_parent_path()) fs::create_directories(fs::path(path).parent_path());
+            return log_sink::to_file(path);
+        };
+        log_sink execLog = open_log(execOut, sim_protocol::EXEC_LOG);
+        log_sink sysLog = open_log(sysOut, sim_protocol::STATUS_LOG);
+        if (!run_simulation(tracePath, *tables, execLog, sysLog, options, input->cache, error)) return 1;
+    } catch (const exception& e) {
+        error = "Error: " + tracePath + ": " + e.what();
+        return 1;
+    }
+
+    // Streamed logs own the client's stdout
+    if (options.logging && execOut != "-" && sysOut != "-")
+        out = "Saved logs:\n  " + execOut + "\n  " + sysOut + "\n";
+    return 0;
+}
+
+// One connection: read the job, run it, answer, close
+static void serve_connection(int fd, server_state& server) {
+    string cwd, payload, out, error;
+    vector<string> args;
+    char tag;
+    bool complete = false;
+    while (!complete && sim_protocol::read_frame(fd, tag, payload)) {
+        if (tag == sim_protocol::CWD) cwd = payload;
+        else if (tag == sim_protocol::ARG) args.push_back(payload);
+        else if (tag == sim_protocol::RUN) complete = true;
+        else break;
+    }
+
+    try {
+        int status = 1;
+        if (!complete) error = "Incomplete request";
+        else if (cwd.empty() || !fs::path(cwd).is_absolute()) error = "Request has no working directory";
+        else status = run_job(fd, move(args), cwd, server, out, error);
+
+        server.served++;
+        if (status != 0) server.failed++;
+        if (!out.empty()) send_frame(fd, sim_protocol::OUT, out);
+        if (!error.empty()) send_frame(fd, sim_protocol::ERROR, error + "\n");
+        send_frame(fd, sim_protocol::DONE, to_string(status));
+    } catch (const exception&) {
+        // The client hung up; nothing left to tell it
+    }
+    close(fd);
+}
+
+// ===== SERVER =====
+
+int run_server(const vector<string>& args, const sim_options& defaults) {
+    string socketPath, inputDir = "input_files";
+    unsigned jobs = 0;
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i] == "--serve" && i + 1 < args.size()) socketPath = args[++i];
+        else if (args[i] == "--input" && i + 1 < args.size()) inputDir = args[++i];
+        else if (args[i] == "--jobs" && i + 1 < args.size()) {
+            int n;
+            if (!parse_int_exact(args[++i], n) || n <= 0) {
+                cerr << "Invalid server option: --jobs " << args[i] << " (expected a positive thread count)" << endl;
+                return 1;
+            }
+            jobs = (unsigned)n;
+        }
+        else { cerr << "Unknown server option: " << args[i] << endl; return 1; }
+    }
+
+    sockaddr_un addr{};
+    if (socketPath.empty() || socketPath.size() >= sizeof addr.sun_path) {
+        cerr << "Usage: sim [options] --serve <socket> [--input DIR] [--jobs N] (socket path under "
+             << sizeof addr.sun_path << " characters)\n";
+        return 1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        cerr << "socket: " << strerror(errno) << endl;
+        return 1;
+    }
+    // A socket left behind by a server that died is in the way of bind()
+    if (fs::is_socket(socketPath)) unlink(socketPath.c_str());
+    if (bind(fd, (sockaddr*)&addr, sizeof addr) < 0 || listen(fd, SOMAXCONN) < 0) {
+        cerr << "Cannot listen on " << socketPath << ": " << strerror(errno) << endl;
+        close(fd);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);   // a client that hangs up fails its write, not the server
+    stopping = false;
+    listen_fd = fd;
+    signal(SIGINT, on_stop_signal);
+    signal(SIGTERM, on_stop_signal);
+
+    server_state server{warm_store(defaults.costs), absolute(fs::path(inputDir)).string(), defaults};
+    {
+        thread_pool pool(jobs);
+        cout << "Serving on " << socketPath << " with " << pool.size() << " threads (input "
+             << server.default_input << ")" << endl;
+        while (!stopping) {
+            int client = accept4(fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                if (!stopping) cerr << "accept: " << strerror(errno) << endl;
+                break;
+            }
+            pool.submit([client, &server] { serve_connection(client, server); });
+        }
+        pool.wait();   // let running jobs finish
+    }
+
+    listen_fd = -1;
+    close(fd);
+    unlink(socketPath.c_str());
+    cout << "Served " << server.served << " jobs (" << server.failed << " failed)" << endl;
+    return 0;
+}
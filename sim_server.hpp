@@ -0,0 +1,66 @@
+#ifndef SIM_SERVER_HPP_
+#define SIM_SERVER_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// ======================== SIMULATION SERVER ========================
+
+// `sim --serve <socket>` keeps the parsed vector/device/external-file tables
+// and the compiled program files in memory (reloading the tables when
+// their files change) and runs jobs from a thread pool. Each connection to
+// the Unix socket carries one job, as frames in log_sink::write_frame's
+// format (tag byte, 32-bit little-endian length, payload):
+//
+//   client -> server   'C' the client's working directory (relative paths
+//                          in the job are taken from it)
+//                      'A' one per argument, exactly what would follow `sim`
+//                          for a single run: [options] <trace> [exec_out] [status_out]
+//                      'R' (empty) run it
+//   server -> client   'O' console output     'X' error message
+//                      'E' / 'S' execution / status log bytes, for an
+//                          output path of "-"
+//                      'D' exit status as text; always the last frame
+//
+// Besides the usual options, a job may give --input DIR for other config
+// tables. `--stats` and `--shutdown` as the only argument query or stop the
+// server.
+namespace sim_protocol {
+
+constexpr char CWD = 'C', ARG = 'A', RUN = 'R';
+constexpr char OUT = 'O', ERROR = 'X', EXEC_LOG = 'E', STATUS_LOG = 'S', DONE = 'D';
+constexpr std::uint32_t MAX_FRAME = 1u << 30;
+
+// False on EOF, a short read or an oversized frame
+inline bool read_frame(int fd, char& tag, std::string& payload) {
+    auto read_all = [fd](char* p, std::size_t n) {
+        while (n > 0) {
+            ssize_t got = ::read(fd, p, n);
+            if (got <= 0) return false;
+            p += got;
+            n -= (std::size_t)got;
+        }
+        return true;
+    };
+    unsigned char header[5];
+    if (!read_all((char*)header, sizeof header)) return false;
+    std::uint32_t len = header[1] | header[2] << 8 | header[3] << 16 | (std::uint32_t)header[4] << 24;
+    if (len > MAX_FRAME) return false;
+    tag = (char)header[0];
+    payload.resize(len);
+    return read_all(payload.data(), len);
+}
+
+}   // namespace sim_protocol
+
+struct sim_options;
+
+// `args` is --serve <socket> [--input DIR] [--jobs N]; `defaults` are the
+// simulation options every job starts from. Runs until SIGINT/SIGTERM or a
+// --shutdown job, then removes the socket. Returns the exit status.
+int run_server(const std::vector<std::string>& args, const sim_options& defaults);
+
+#endif
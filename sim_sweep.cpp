@@ -0,0 +1,251 @@
+#include "sim_sweep.hpp"
+#include "nested_simulator.hpp"
+#include "thread_pool.hpp"
+#include "text_scan.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <optional>
+#include <stdexcept>
+using namespace std;
+namespace fs = std::filesystem;
+
+// ===== AXES =====
+
+size_t sweep_axes::size() const {
+    size_t n = 1;
+    for (size_t len : {context_save.size(), load_rate.size(), delay_scale.size(), partitions.size()}) {
+        len = max<size_t>(len, 1);
+        n = n > SIZE_MAX / len ? SIZE_MAX : n * len;
+    }
+    return n;
+}
+
+vector<int> parse_sweep_values(const string& spec) {
+    auto bad = [&spec] { return runtime_error("bad value list '" + spec + "' (use 10,20,30 or FROM:TO:STEP)"); };
+    vector<int> values;
+    for (const string& item : split_delim(spec, ",")) {
+        if (item.empty()) continue;
+        vector<string> range = split_delim(item, ":");
+        int from, to, step;
+        if (range.size() == 1) {
+            if (!parse_int_exact(item, from)) throw bad();
+            to = from, step = 1;
+        } else if (range.size() != 3 || !parse_int_exact(range[0], from) || !parse_int_exact(range[1], to) ||
+                   !parse_int_exact(range[2], step) || step <= 0 || to < from) {
+            throw bad();
+        }
+        // Counted before expanding, so 0:2000000000:1 fails without filling memory
+        long long count = ((long long)to - from) / step + 1;
+        if (count > (long long)(MAX_SWEEP_POINTS - values.size()))
+            throw runtime_error("value list '" + spec + "' has more than " + to_string(MAX_SWEEP_POINTS) + " values");
+        for (long long v = from; v <= to; v += step) values.push_back((int)v);
+    }
+    if (values.empty()) throw runtime_error("empty value list '" + spec + "'");
+    return values;
+}
+
+sweep_point sweep_at(const sweep_axes& axes, size_t index) {
+    // Mixed radix, the last axis varying fastest
+    auto digit = [&index](size_t radix) {
+        radix = max<size_t>(radix, 1);
+        size_t d = index % radix;
+        index /= radix;
+        return d;
+    };
+    sweep_point p;
+    p.delay_scale = digit(axes.delay_scale.size());
+    p.load_rate = digit(axes.load_rate.size());
+    p.context_save = digit(axes.context_save.size());
+    p.partitions = digit(axes.partitions.size());
+    return p;
+}
+
+sim_options sweep_options(const sim_options& base, const sweep_axes& axes, const sweep_point& point) {
+    sim_options options = base;
+    if (!axes.context_save.empty()) {
+        int save = axes.context_save[point.context_save];
+        options.costs.defaults.context_save = save;
+        for (auto& [vector, costs] : options.costs.per_vector) costs.context_save = save;
+    }
+    if (!axes.load_rate.empty()) options.costs.load_rate = axes.load_rate[point.load_rate];
+    if (!axes.partitions.empty()) options.partition_sizes = axes.partitions[point.partitions];
+    return options;
+}
+
+// ===== RUNS =====
+
+// Everything the runs share; none of it changes once the sweep starts
+struct sweep_input {
+    const sim_tables& tables;
+    program_cache& cache;
+    string_pool names;
+    compiled_trace trace;                               // default engine
+    shared_ptr<const compiled_program> program;         // nested and event engines
+};
+
+static void run_point(const sweep_input& input, const sim_options& options, int delay_scale,
+                      const sim_options& base, sweep_result& result) {
+    const sim_tables& tables = input.tables;
+
+    // The shared dispatch table already has the base costs and delays
+    optional<dispatch_table> own;
+    if (options.costs != base.costs || delay_scale != 100) {
+        vector<int> delays = tables.delays;
+        for (int& d : delays) d = (int)((long long)d * delay_scale / 100);
+        own.emplace(tables.vectors, delays, options.costs);
+    }
+    const dispatch_table& dispatch = own ? *own : tables.dispatch;
+
+    simulator_context ctx(options.partition_sizes, options.policy);
+    PCB current(0, -1, "init", 1, -1);
+    if (!allocate_memory(ctx, &current)) throw runtime_error("ERROR! Memory allocation failed!");
+    log_sink execLog = log_sink::discard(), sysLog = log_sink::discard();
+
+    if (options.event_driven) {
+        event_config config = options.events;
+        config.status = options.status;
+        event_engine engine(ctx, input.cache, tables.catalog, dispatch, config, execLog, sysLog);
+        const event_engine::stats& totals = engine.run(input.program, current);
+        result.total_time = totals.end_time;
+        result.failed_forks = totals.failed_forks;
+    } else if (options.exec_programs) {
+        nested_simulator sim(ctx, input.cache, tables.catalog, dispatch, execLog, sysLog, options.status);
+        result.total_time = sim.run(input.program, current);
+        result.failed_forks = sim.failed_forks();
+    } else {
+        trace_simulator sim(ctx, input.names, dispatch, tables.catalog, current, 0, execLog, sysLog, &tables.timings);
+        for (const instruction& ins : input.trace.code)
+            sim.step(ins, ins.op == opcode::UNKNOWN ? string_view(input.trace.literals[ins.program]) : string_view());
+        // Fixed timings (fixed_timings.txt) overwrite the clock, so the
+        // swept costs would not show up in the total
+        if (sim.fixed_timings()) {
+            result.invalid = true;
+            result.error = "the trace hits a rule in fixed_timings.txt (sweep it with --exec-programs)";
+            return;
+        }
+        result.total_time = sim.time();
+        result.failed_forks = sim.failed_forks();
+    }
+    result.peak_partitions = ctx.partitions.peak_used();
+    result.ok = true;
+}
+
+vector<sweep_result> run_sweep(const string& tracePath, const sim_tables& tables, const sim_options& base,
+                               const sweep_axes& axes, program_cache& cache, unsigned jobs) {
+    sweep_input input{tables, cache, {}, {}, nullptr};
+    if (base.event_driven || base.exec_programs)
+        input.program = make_shared<const compiled_program>(compile_program(tracePath));
+    else
+        input.trace = compile_trace_file(tracePath, input.names);
+
+    vector<sweep_result> results(axes.size());
+    thread_pool pool(jobs);
+    for (size_t i = 0; i < results.size(); i++) {
+        pool.submit([&, i] {
+            sweep_result& result = results[i];
+            result.point = sweep_at(axes, i);
+            int scale = axes.delay_scale.empty() ? 100 : axes.delay_scale[result.point.delay_scale];
+            try {
+                run_point(input, sweep_options(base, axes, result.point), scale, base, result);
+            } catch (const exception& e) {
+                result.error = e.what();
+            }
+        });
+    }
+    pool.wait();
+    return results;
+}
+
+// ===== COMMAND =====
+
+static string join_sizes(const vector<unsigned>& sizes) {
+    string s;
+    for (unsigned size : sizes) s += (s.empty() ? "" : ",") + to_string(size);
+    return s;
+}
+
+int run_sweep_command(const vector<string>& args, const sim_options& base) {
+    string tracePath, inputDir = "input_files", csvPath;
+    unsigned jobs = 0;
+    sweep_axes axes;
+    try {
+        for (size_t i = 0; i < args.size(); i++) {
+            bool has_value = i + 1 < args.size();
+            if (args[i] == "--sweep" && has_value) tracePath = args[++i];
+            else if (args[i] == "--vary-save" && has_value) axes.context_save = parse_sweep_values(args[++i]);
+            else if (args[i] == "--vary-load-rate" && has_value) axes.load_rate = parse_sweep_values(args[++i]);
+            else if (args[i] == "--vary-delays" && has_value) axes.delay_scale = parse_sweep_values(args[++i]);
+            else if (args[i] == "--vary-partitions" && has_value) {
+                for (const string& set : split_delim(args[++i], ";"))
+                    if (!set.empty()) axes.partitions.push_back(parse_partition_sizes(set));
+            } else if (args[i] == "--jobs" && has_value) {
+                int n;
+                if (!parse_int_exact(args[++i], n) || n <= 0)
+                    throw runtime_error("--jobs " + args[i] + " (expected a positive thread count)");
+                jobs = (unsigned)n;
+            }
+            else if (args[i] == "--input" && has_value) inputDir = args[++i];
+            else if (args[i] == "--csv" && has_value) csvPath = args[++i];
+            else { cerr << "Unknown sweep option: " << args[i] << endl; return 1; }
+        }
+    } catch (const exception& e) {
+        cerr << "Invalid sweep: " << e.what() << endl;
+        return 1;
+    }
+    if (tracePath.empty() || tracePath == "-") {
+        cerr << "A sweep needs a trace file: sim [options] --sweep <trace> [--vary-...]\n";
+        return 1;
+    }
+    for (int scale : axes.delay_scale) {
+        if (scale < 0) { cerr << "Invalid sweep: negative delay scale " << scale << "%\n"; return 1; }
+    }
+    if (axes.size() > MAX_SWEEP_POINTS) {
+        cerr << "Invalid sweep: more than " << MAX_SWEEP_POINTS << " configurations; narrow an axis\n";
+        return 1;
+    }
+
+    const sim_tables tables = load_tables(tracePath, inputDir, base.costs);
+    program_cache cache(inputDir);
+    cout << "Sweeping " << axes.size() << " configurations of " << tracePath << endl;
+    vector<sweep_result> results;
+    try {
+        results = run_sweep(tracePath, tables, base, axes, cache, jobs);
+    } catch (const exception& e) {
+        cerr << "Error: " << tracePath << ": " << e.what() << endl;
+        return 1;
+    }
+
+    // The value of each axis at a point, or the base value for an unswept one
+    auto values = [&](const sweep_point& p) {
+        sim_options o = sweep_options(base, axes, p);
+        int scale = axes.delay_scale.empty() ? 100 : axes.delay_scale[p.delay_scale];
+        return make_tuple(o.costs.defaults.context_save, o.costs.load_rate, scale, join_sizes(o.partition_sizes));
+    };
+
+    cout << setw(8) << "save" << setw(10) << "load/MB" << setw(9) << "delays%" << "  " << left << setw(22)
+         << "partitions" << right << setw(12) << "total_time" << setw(14) << "failed_forks" << setw(16)
+         << "peak_partitions" << "\n";
+    int failed = 0;
+    for (const sweep_result& r : results) {
+        auto [save, rate, scale, sizes] = values(r.point);
+        cout << setw(8) << save << setw(10) << rate << setw(9) << scale << "  " << left << setw(22) << sizes << right;
+        if (r.ok) cout << setw(12) << r.total_time << setw(14) << r.failed_forks << setw(16) << r.peak_partitions << "\n";
+        else { cout << (r.invalid ? "  invalid: " : "  error: ") << r.error << "\n"; failed++; }
+    }
+
+    if (!csvPath.empty()) {
+        ofstream csv(csvPath);
+        if (!csv) { cerr << "Cannot open " << csvPath << " for writing\n"; return 1; }
+        csv << "context_save,load_rate,delay_scale,partitions,total_time,failed_forks,peak_partitions,error\n";
+        for (const sweep_result& r : results) {
+            auto [save, rate, scale, sizes] = values(r.point);
+            csv << save << ',' << rate << ',' << scale << ",\"" << sizes << "\",";
+            if (r.ok) csv << r.total_time << ',' << r.failed_forks << ',' << r.peak_partitions << ",\n";
+            else csv << ",,,\"" << r.error << "\"\n";
+        }
+        cout << "Saved " << csvPath << "\n";
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,66 @@
+#ifndef SIM_SWEEP_HPP_
+#define SIM_SWEEP_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sim_runner.hpp"
+
+// ======================== PARAMETER SWEEPS ========================
+
+// The values tried for each parameter; a sweep runs their Cartesian product.
+// An axis left empty keeps the base options' value.
+struct sweep_axes {
+    std::vector<int> context_save;   // ms, every vector
+    std::vector<int> load_rate;      // ms per MB loaded by EXEC
+    std::vector<int> delay_scale;    // percent of every device delay
+    std::vector<std::vector<unsigned>> partitions;
+
+    std::size_t size() const;   // number of configurations, SIZE_MAX on overflow
+};
+
+// One configuration: an index into each axis (0 for an empty axis)
+struct sweep_point {
+    std::size_t context_save = 0, load_rate = 0, delay_scale = 0, partitions = 0;
+};
+
+struct sweep_result {
+    sweep_point point;
+    bool ok = false;
+    bool invalid = false;   // ran, but the default engine's fixed timings ignore the costs
+    std::string error;
+    long long total_time = 0;       // simulated ms at the end of the trace
+    std::uint64_t failed_forks = 0;
+    std::size_t peak_partitions = 0;   // most partitions in use at once
+};
+
+// Most configurations one sweep runs, and most values in one list
+constexpr std::size_t MAX_SWEEP_POINTS = 1000000;
+
+// "10,20,30", "10:30:5" (inclusive, step 5) or a mix ("5,10:30:10").
+// Throws std::runtime_error on a bad list.
+std::vector<int> parse_sweep_values(const std::string& spec);
+
+// Configuration `index` in row-major order (partitions vary slowest)
+sweep_point sweep_at(const sweep_axes& axes, std::size_t index);
+
+// `base` with one configuration applied
+sim_options sweep_options(const sim_options& base, const sweep_axes& axes, const sweep_point& point);
+
+// Runs every configuration of `axes` on `trace_path` over `jobs` threads
+// (0 = one per core), without logs. The trace is compiled once; the tables,
+// the compiled trace and the program cache are shared read-only by every
+// run, and a run only owns its simulator_context and its dispatch table
+// (rebuilt when its costs or delays differ). Results are in configuration
+// order.
+std::vector<sweep_result> run_sweep(const std::string& trace_path, const sim_tables& tables,
+                                    const sim_options& base, const sweep_axes& axes,
+                                    program_cache& cache, unsigned jobs = 0);
+
+// sim [options] --sweep <trace> [--vary-save VALUES] [--vary-load-rate VALUES]
+//     [--vary-delays PERCENTS] [--vary-partitions "SIZES;SIZES..."]
+//     [--jobs N] [--input DIR] [--csv FILE]
+int run_sweep_command(const std::vector<std::string>& args, const sim_options& base);
+
+#endif
@@ -0,0 +1,74 @@
+// simc: client for a running `sim --serve` server
+//
+//   simc <socket> [sim options] <trace> [execution_out|-] [status_out|-]
+//   simc <socket> --stats | --shutdown
+//
+// Relative paths are taken from the current directory. A log path of "-"
+// streams that log to stdout. Exits with the job's status.
+#include "sim_server.hpp"
+#include "log_writer.hpp"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/un.h>
+using namespace std;
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "Usage: simc <socket> [sim options] <trace> [execution_out|-] [status_out|-]\n"
+                "       simc <socket> --stats | --shutdown\n";
+        return 1;
+    }
+
+    sockaddr_un addr{};
+    string socketPath = argv[1];
+    if (socketPath.size() >= sizeof addr.sun_path) {
+        cerr << "Socket path too long: " << socketPath << endl;
+        return 1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof addr) < 0) {
+        cerr << "Cannot connect to " << socketPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    try {
+        log_sink::write_frame(fd, sim_protocol::CWD, fs::current_path().string());
+        for (int i = 2; i < argc; i++) log_sink::write_frame(fd, sim_protocol::ARG, argv[i]);
+        log_sink::write_frame(fd, sim_protocol::RUN, "");
+    } catch (const exception& e) {
+        cerr << "Cannot send the job: " << e.what() << endl;
+        return 1;
+    }
+
+    // Answer frames until 'D'
+    string payload;
+    char tag;
+    while (sim_protocol::read_frame(fd, tag, payload)) {
+        switch (tag) {
+            case sim_protocol::OUT:
+            case sim_protocol::EXEC_LOG:
+            case sim_protocol::STATUS_LOG:
+                cout.write(payload.data(), (streamsize)payload.size());
+                break;
+            case sim_protocol::ERROR:
+                cout.flush();
+                cerr << payload;
+                break;
+            case sim_protocol::DONE:
+                cout.flush();
+                return atoi(payload.c_str());
+            default:
+                break;
+        }
+    }
+    cout.flush();
+    cerr << "Server closed the connection before the job finished\n";
+    return 1;
+}
@@ -0,0 +1,97 @@
+// Rebuilds the full process table from a delta system status log
+// (sim --status-delta), as it stood at a given time.
+// Usage: status_replay <status_log | -> [time]
+#include "pcb_table.hpp"
+#include "trace_reader.hpp"
+#include <charconv>
+#include <climits>
+#include <iostream>
+#include <unistd.h>
+
+using namespace std;
+
+// Splits off the next space-separated field
+static string_view field(string_view& rest) {
+    size_t sp = rest.find(' ');
+    string_view f = rest.substr(0, sp);
+    rest = sp == string_view::npos ? string_view() : rest.substr(sp + 1);
+    return f;
+}
+
+template <typename T>
+static T number(string_view s) {
+    T v{};
+    auto res = from_chars(s.data(), s.data() + s.size(), v);
+    if (res.ec != errc() || res.ptr != s.data() + s.size())
+        throw runtime_error("bad number '" + string(s) + "'");
+    return v;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "Usage: status_replay <status_log | -> [time]\n";
+        return 1;
+    }
+    long long until = argc > 2 ? stoll(argv[2]) : LLONG_MAX;
+
+    pcb_table table;
+    long long time = -1;
+    string label;
+    int val = 0;
+
+    try {
+        auto reader = line_reader::open(argv[1]);
+        string_view line;
+        while (reader->next(line)) {
+            try {
+                if (line.empty()) continue;
+
+                // time: <t>; current trace: <label>, <val>
+                if (line.rfind("time: ", 0) == 0) {
+                    size_t semi = line.find(';'), comma = line.rfind(", ");
+                    size_t at = line.find("current trace: ");
+                    if (semi == string_view::npos || comma == string_view::npos || at == string_view::npos)
+                        throw runtime_error("bad snapshot header");
+                    long long t = number<long long>(line.substr(6, semi - 6));
+                    if (t > until) break;
+                    time = t;
+                    at += 15;
+                    label = string(line.substr(at, comma - at));
+                    val = number<int>(line.substr(comma + 2));
+                    continue;
+                }
+                if (time < 0) throw runtime_error("row before the first snapshot header");
+
+                string_view rest = line.substr(min<size_t>(2, line.size()));
+                if (line.rfind("+ ", 0) == 0) {
+                    unsigned pid = number<unsigned>(field(rest));
+                    int ppid = number<int>(field(rest));
+                    string_view program = field(rest);
+                    int partition = number<int>(field(rest));
+                    unsigned size = number<unsigned>(field(rest));
+                    pcb_state state;
+                    if (!parse_pcb_state(field(rest), state)) throw runtime_error("bad state");
+                    table.add(pid, ppid, program, size, partition, state);
+                } else if (line.rfind("- ", 0) == 0) {
+                    unsigned pid = number<unsigned>(field(rest));
+                    if (table.contains(pid)) table.set_state(pid, pcb_state::TERMINATED);
+                } else {
+                    throw runtime_error("not a delta status line (was the log written with --status-delta?)");
+                }
+            } catch (const exception& e) {
+                throw runtime_error("line " + to_string(reader->line_number()) + ": " + e.what());
+            }
+        }
+    } catch (const exception& e) {
+        cerr << argv[1] << ": " << e.what() << endl;
+        return 1;
+    }
+
+    if (time < 0) {
+        cerr << "No snapshot at or before that time\n";
+        return 1;
+    }
+    log_sink out = log_sink::to_fd(STDOUT_FILENO);
+    table.write_table(out, time, label, val);
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "text_scan.hpp"
+#include <charconv>
+#include <climits>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TEXT_SCAN_X86 1
+#endif
+
+using namespace std;
+
+// ===== CLASSIFIERS =====
+
+// Each classifies exactly 64 readable bytes at `p`
+
+static delimiter_word classify_scalar(const char* p) {
+    uint64_t structural = 0, space = 0;
+    for (int i = 0; i < 64; i++) {
+        unsigned char c = (unsigned char)p[i];
+        structural |= (uint64_t)(c == '\n' || c == ',') << i;
+        space |= (uint64_t)(c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t') << i;
+    }
+    return {structural, space};
+}
+
+#ifdef TEXT_SCAN_X86
+static delimiter_word classify_sse2(const char* p) {
+    const __m128i newline = _mm_set1_epi8('\n'), comma = _mm_set1_epi8(','), blank = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t'), range = _mm_set1_epi8('\r' - '\t');
+    uint64_t structural = 0, space = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + 16 * i));
+        __m128i s = _mm_or_si128(_mm_cmpeq_epi8(v, newline), _mm_cmpeq_epi8(v, comma));
+        // '\t'..'\r' is one unsigned range: c - '\t' <= 4
+        __m128i off = _mm_sub_epi8(v, tab);
+        __m128i w = _mm_or_si128(_mm_cmpeq_epi8(v, blank), _mm_cmpeq_epi8(_mm_min_epu8(off, range), off));
+        structural |= (uint64_t)(uint16_t)_mm_movemask_epi8(s) << (16 * i);
+        space |= (uint64_t)(uint16_t)_mm_movemask_epi8(w) << (16 * i);
+    }
+    return {structural, space};
+}
+
+__attribute__((target("avx2")))
+static delimiter_word classify_avx2(const char* p) {
+    const __m256i newline = _mm256_set1_epi8('\n'), comma = _mm256_set1_epi8(','), blank = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t'), range = _mm256_set1_epi8('\r' - '\t');
+    uint64_t structural = 0, space = 0;
+    for (int i = 0; i < 2; i++) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + 32 * i));
+        __m256i s = _mm256_or_si256(_mm256_cmpeq_epi8(v, newline), _mm256_cmpeq_epi8(v, comma));
+        __m256i off = _mm256_sub_epi8(v, tab);
+        __m256i w = _mm256_or_si256(_mm256_cmpeq_epi8(v, blank),
+                                    _mm256_cmpeq_epi8(_mm256_min_epu8(off, range), off));
+        structural |= (uint64_t)(uint32_t)_mm256_movemask_epi8(s) << (32 * i);
+        space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(w) << (32 * i);
+    }
+    return {structural, space};
+}
+
+__attribute__((target("avx2")))
+static size_t count_newlines_avx2(const char* p, size_t n) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    size_t count = 0, i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        count += (size_t)__builtin_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline)));
+    }
+    for (; i < n; i++) count += p[i] == '\n';
+    return count;
+}
+
+static size_t count_newlines_sse2(const char* p, size_t n) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    size_t count = 0, i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        count += (size_t)__builtin_popcount((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)));
+    }
+    for (; i < n; i++) count += p[i] == '\n';
+    return count;
+}
+#endif
+
+// ===== DISPATCH =====
+
+static simd_level best_supported() {
+#ifdef TEXT_SCAN_X86
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? simd_level::AVX2 : simd_level::SSE2;
+#else
+    return simd_level::SCALAR;
+#endif
+}
+
+static const simd_level supported = best_supported();
+static simd_level active = supported;
+
+const char* simd_level_name(simd_level level) {
+    switch (level) {
+        case simd_level::AVX2: return "avx2";
+        case simd_level::SSE2: return "sse2";
+        default:               return "scalar";
+    }
+}
+
+simd_level simd_active() { return active; }
+
+simd_level simd_select(simd_level level) {
+    active = level > supported ? supported : level;
+    return active;
+}
+
+static delimiter_word classify(const char* p) {
+#ifdef TEXT_SCAN_X86
+    if (active == simd_level::AVX2) return classify_avx2(p);
+    if (active == simd_level::SSE2) return classify_sse2(p);
+#endif
+    return classify_scalar(p);
+}
+
+// ===== INDEX =====
+
+void delimiter_index::scan(string_view text) {
+    length = text.size();
+    size_t count = (text.size() + 63) / 64, full = text.size() / 64;
+    spaces.resize(count);
+    // One slot per byte at most, plus room for the unchecked writes below
+    if (positions.size() < text.size() + 64) positions.resize(text.size() + 64);
+    uint32_t* out = positions.data();
+    for (size_t w = 0; w < count; w++) {
+        delimiter_word word;
+        if (w < full) word = classify(text.data() + 64 * w);
+        else {
+            // Zero padding is neither a delimiter nor whitespace
+            char tail[64] = {};
+            memcpy(tail, text.data() + 64 * w, text.size() - 64 * w);
+            word = classify(tail);
+        }
+        spaces[w] = word.space;
+        // Traces average about one delimiter per 5 bytes, so the first 16
+        // are written without checking; the extra slots are overwritten
+        uint32_t base = (uint32_t)(64 * w);
+        uint64_t m = word.structural;
+        int n = __builtin_popcountll(m);
+        for (int i = 0; i < 16; i++) {
+            out[i] = base + (uint32_t)__builtin_ctzll(m | 1ull << 63);
+            m &= m - 1;
+        }
+        for (int i = 16; i < n; i++) {
+            out[i] = base + (uint32_t)__builtin_ctzll(m);
+            m &= m - 1;
+        }
+        out += n;
+    }
+    found = (size_t)(out - positions.data());
+    *out = (uint32_t)text.size();
+}
+
+size_t count_newlines(string_view text) {
+#ifdef TEXT_SCAN_X86
+    if (active == simd_level::AVX2) return count_newlines_avx2(text.data(), text.size());
+    if (active == simd_level::SSE2) return count_newlines_sse2(text.data(), text.size());
+#endif
+    size_t count = 0;
+    for (char c : text) count += c == '\n';
+    return count;
+}
+
+// ===== NUMBERS =====
+
+static bool is_space(char c) { return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t'; }
+
+bool parse_int(string_view field, int& value) {
+    const char* p = field.data();
+    const char* end = p + field.size();
+    while (p < end && is_space(*p)) p++;
+    bool negative = false;
+    if (p < end && (*p == '+' || *p == '-')) negative = *p++ == '-';
+    if (p == end || (unsigned)(*p - '0') > 9) return false;
+
+    // Digits as unsigned so INT_MIN's magnitude fits
+    unsigned long long magnitude;
+    if (from_chars(p, end, magnitude).ec != errc() || magnitude > (unsigned long long)INT_MAX + negative) return false;
+    value = (int)(negative ? -(long long)magnitude : (long long)magnitude);
+    return true;
+}
+
+bool parse_int_exact(string_view field, int& value) {
+    while (!field.empty() && is_space(field.back())) field.remove_suffix(1);
+    while (!field.empty() && is_space(field.front())) field.remove_prefix(1);
+    size_t first = !field.empty() && (field[0] == '+' || field[0] == '-');
+    if (field.find_first_not_of("0123456789", first) != string_view::npos) return false;
+    return parse_int(field, value);
+}
@@ -0,0 +1,85 @@
+#ifndef TEXT_SCAN_HPP_
+#define TEXT_SCAN_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// ======================== DELIMITER SCANNING ========================
+
+// Classifies text 64 bytes at a time with SSE2 or AVX2 compares, falling
+// back to a plain loop on other targets. The widest level the CPU supports
+// is picked at startup.
+enum class simd_level : std::uint8_t { SCALAR, SSE2, AVX2 };
+
+const char* simd_level_name(simd_level level);
+simd_level simd_active();
+// Use `level`, or the best supported one below it; returns what is now active
+simd_level simd_select(simd_level level);
+
+// One bit per byte of a 64-byte word; bit i is byte 64*w + i
+struct delimiter_word {
+    std::uint64_t structural;   // '\n' or ','
+    std::uint64_t space;        // isspace() in the C locale
+};
+
+// Where the delimiters of a block of text are. The positions are pulled out
+// of the masks in one pass, so a parser walks them in order without a
+// search per field.
+class delimiter_index {
+public:
+    explicit delimiter_index(std::string_view text) { scan(text); }
+    delimiter_index() = default;
+
+    void scan(std::string_view text);   // reuses the storage; texts up to 4 GB
+
+    // Offsets of every '\n' and ',' in order, then size() as a sentinel
+    const std::uint32_t* structurals() const { return positions.data(); }
+    std::size_t structural_count() const { return found; }
+
+    // True if any byte in [from, to) is whitespace
+    bool any_space(std::size_t from, std::size_t to) const {
+        if (from >= to) return false;
+        std::size_t first = from >> 6, last = (to - 1) >> 6;
+        std::uint64_t head = ~0ull << (from & 63), tail = ~0ull >> (63 - ((to - 1) & 63));
+        if (first == last) return (spaces[first] & head & tail) != 0;
+        if (spaces[first] & head) return true;
+        for (std::size_t w = first + 1; w < last; w++)
+            if (spaces[w]) return true;
+        return (spaces[last] & tail) != 0;
+    }
+
+    std::size_t size() const { return length; }
+
+private:
+    std::vector<std::uint64_t> spaces;
+    std::vector<std::uint32_t> positions;   // only grows; the first found + 1 are valid
+    std::size_t found = 0;
+    std::size_t length = 0;
+};
+
+// Number of '\n' in `text`
+std::size_t count_newlines(std::string_view text);
+
+// stoi semantics without the exception: leading whitespace, an optional
+// sign, then digits up to the first non-digit. False when there are no
+// digits or the value does not fit an int.
+bool parse_int(std::string_view field, int& value);
+
+// parse_int where nothing but whitespace may follow the digits ("10x" fails);
+// for option values and tables that must hold exactly one number
+bool parse_int_exact(std::string_view field, int& value);
+
+// ======================== HASHING ========================
+
+constexpr std::uint64_t FNV1A_SEED = 0xcbf29ce484222325ull;
+
+// 64-bit FNV-1a. Pass the previous result as `seed` to hash several fields
+// as if they were one concatenated string.
+inline std::uint64_t fnv1a(std::string_view bytes, std::uint64_t seed = FNV1A_SEED) {
+    for (char c : bytes) { seed ^= (std::uint8_t)c; seed *= 0x100000001b3ull; }
+    return seed;
+}
+
+#endif
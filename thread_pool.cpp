@@ -0,0 +1,99 @@
+#include "thread_pool.hpp"
+
+using namespace std;
+
+thread_pool::thread_pool(unsigned threads) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    for (unsigned i = 0; i < threads; i++) queues.push_back(make_unique<task_queue>());
+    for (unsigned i = 0; i < threads; i++) workers.emplace_back(&thread_pool::run, this, i);
+}
+
+thread_pool::~thread_pool() {
+    {
+        lock_guard<mutex> guard(state_lock);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto& w : workers) w.join();
+}
+
+// Counted before it is published: a task submitted from inside another task
+// must already be pending when a worker can steal it, or wait() could see
+// pending reach 0 between the steal and the count
+void thread_pool::submit(function<void()> task) {
+    unsigned index = next_queue++ % queues.size();
+    {
+        lock_guard<mutex> guard(state_lock);
+        queued++;
+        pending++;
+    }
+    {
+        lock_guard<mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(move(task));
+    }
+    work_ready.notify_one();
+}
+
+void thread_pool::wait() {
+    unique_lock<mutex> guard(state_lock);
+    all_done.wait(guard, [this] { return pending == 0; });
+    if (failure) {
+        exception_ptr e = failure;
+        failure = nullptr;
+        rethrow_exception(e);
+    }
+}
+
+// Own deque first (newest task), then steal the oldest task from the others
+bool thread_pool::try_take(unsigned index, function<void()>& task) {
+    {
+        lock_guard<mutex> guard(queues[index]->lock);
+        auto& own = queues[index]->tasks;
+        if (!own.empty()) {
+            task = move(own.back());
+            own.pop_back();
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); k++) {
+        auto& victim = *queues[(index + k) % queues.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void thread_pool::run(unsigned index) {
+    for (;;) {
+        {
+            unique_lock<mutex> guard(state_lock);
+            work_ready.wait(guard, [this] { return queued > 0 || stopping; });
+            if (stopping && queued == 0) return;
+        }
+
+        function<void()> task;
+        if (!try_take(index, task)) {
+            this_thread::yield();   // another worker got there first
+            continue;
+        }
+        {
+            lock_guard<mutex> guard(state_lock);
+            queued--;
+        }
+
+        exception_ptr error;
+        try {
+            task();
+        } catch (...) {
+            error = current_exception();
+        }
+
+        lock_guard<mutex> guard(state_lock);
+        if (error && !failure) failure = error;
+        if (--pending == 0) all_done.notify_all();
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_HPP_
+#define THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ====================== WORK-STEALING POOL ======================
+
+// Fixed set of workers, each with its own task deque. A worker takes work
+// from the back of its own deque and, when that is empty, steals from the
+// front of the others. Tasks are handed out round-robin on submit().
+class thread_pool {
+public:
+    explicit thread_pool(unsigned threads = 0);   // 0 = one per core
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // Safe to call from a running task; wait() then covers the new task too
+    void submit(std::function<void()> task);
+
+    // Blocks until every submitted task has finished. Rethrows the first
+    // exception a task let escape.
+    void wait();
+
+    unsigned size() const { return (unsigned)workers.size(); }
+
+private:
+    struct task_queue {
+        std::mutex lock;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void run(unsigned index);
+    bool try_take(unsigned index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<task_queue>> queues;
+    std::vector<std::thread> workers;
+    std::atomic<unsigned> next_queue{0};
+
+    std::mutex state_lock;
+    std::condition_variable work_ready, all_done;
+    std::size_t queued = 0;    // submitted, not yet picked up
+    std::size_t pending = 0;   // submitted, not yet finished
+    bool stopping = false;
+    std::exception_ptr failure;
+};
+
+#endif
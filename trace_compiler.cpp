@@ -0,0 +1,243 @@
+#include "trace_compiler.hpp"
+#include "trace_reader.hpp"
+#include "profile.hpp"
+#include "text_scan.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+const char* opcode_name(opcode op) {
+    switch (op) {
+        case opcode::FORK:      return "FORK";
+        case opcode::EXEC:      return "EXEC";
+        case opcode::CPU:       return "CPU";
+        case opcode::SYSCALL:   return "SYSCALL";
+        case opcode::END_IO:    return "END_IO";
+        case opcode::IF_CHILD:  return "IF_CHILD";
+        case opcode::IF_PARENT: return "IF_PARENT";
+        case opcode::ENDIF:     return "ENDIF";
+        default:                return "UNKNOWN";
+    }
+}
+
+string_pool& string_pool::operator=(const string_pool& other) {
+    if (this != &other) {
+        names = other.names;
+        reindex();
+    }
+    return *this;
+}
+
+void string_pool::reindex() {
+    index.clear();
+    for (uint32_t id = 0; id < names.size(); id++) index.emplace(names[id], id);
+}
+
+uint32_t string_pool::intern(string_view name) {
+    auto it = index.find(name);
+    if (it != index.end()) return it->second;
+    uint32_t id = (uint32_t)names.size();
+    names.emplace_back(name);
+    index.emplace(names.back(), id);
+    return id;
+}
+
+uint32_t string_pool::find(string_view name) const {
+    auto it = index.find(name);
+    return it == index.end() ? npos : it->second;
+}
+
+// Same as the old trim: every whitespace character goes, not just the ends
+static string squeeze(string_view field) {
+    string out;
+    out.reserve(field.size());
+    for (char c : field)
+        if (!isspace((unsigned char)c)) out += c;
+    return out;
+}
+
+// Accepts what stoi accepted: optional sign, digits, trailing junk ignored.
+// `field` has no whitespace left in it.
+static int32_t parse_operand(string_view field) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < field.size() && (field[i] == '+' || field[i] == '-')) negative = field[i++] == '-';
+    if (i == field.size() || !isdigit((unsigned char)field[i]))
+        throw runtime_error("invalid operand '" + string(field) + "'");
+    unsigned long long v;
+    if (from_chars(field.data() + i, field.data() + field.size(), v).ec != errc() ||
+        v > (unsigned long long)INT_MAX + negative)
+        throw runtime_error("operand out of range '" + string(field) + "'");
+    return (int32_t)(negative ? -(long long)v : (long long)v);
+}
+
+static instruction unknown_line(string_view line, vector<string>& literals) {
+    literals.emplace_back(line);
+    return instruction{opcode::UNKNOWN, 0, (uint32_t)(literals.size() - 1), 0};
+}
+
+// The plain keywords (all but EXEC), or UNKNOWN. Every keyword has a
+// different length, so the length picks the only candidate.
+static opcode keyword(string_view activity) {
+    static constexpr opcode OPS[] = {opcode::UNKNOWN, opcode::UNKNOWN, opcode::UNKNOWN, opcode::CPU,
+                                     opcode::FORK, opcode::ENDIF, opcode::END_IO, opcode::SYSCALL,
+                                     opcode::IF_CHILD, opcode::IF_PARENT};
+    static constexpr char NAMES[][10] = {"", "", "", "CPU", "FORK", "ENDIF", "END_IO", "SYSCALL",
+                                         "IF_CHILD", "IF_PARENT"};
+    size_t n = activity.size();
+    if (n >= size(OPS) || OPS[n] == opcode::UNKNOWN || memcmp(activity.data(), NAMES[n], n) != 0)
+        return opcode::UNKNOWN;
+    return OPS[n];
+}
+
+// The opcode part of a line, once the activity and operand are cut out
+static instruction decode(string_view line, string_view activity, int32_t value,
+                          string_pool& names, vector<string>& literals) {
+    if (activity.substr(0, 4) == "EXEC") {
+        string_view image = activity.substr(4);
+        if (!image.empty() && image[0] == '_') image.remove_prefix(1);
+        string_view program = image.substr(0, image.find('_'));
+        return instruction{opcode::EXEC, value, names.intern(program), names.intern(image)};
+    }
+
+    opcode op = keyword(activity);
+    if (op == opcode::UNKNOWN) return unknown_line(line, literals);
+    return instruction{op, value, 0, 0};
+}
+
+instruction compile_line(string_view line, string_pool& names, vector<string>& literals) {
+    PROFILE_SCOPE(profile_counter::PARSE);
+    size_t c1 = line.find(',');
+    if (c1 == string_view::npos) return unknown_line(line, literals);
+    size_t c2 = line.find(',', c1 + 1);
+    string activity = squeeze(line.substr(0, c1));
+    int32_t value = parse_operand(squeeze(line.substr(c1 + 1, c2 == string_view::npos ? string_view::npos : c2 - c1 - 1)));
+    return decode(line, activity, value, names, literals);
+}
+
+size_t compile_block(string_view text, size_t first_line, string_pool& names,
+                     compiled_trace& out, vector<size_t>* line_numbers) {
+    PROFILE_SCOPE(profile_counter::PARSE);
+    static thread_local delimiter_index index;
+    index.scan(text);
+    string activity_buf, operand_buf;
+    size_t line_no = first_line, start = 0;
+
+    // Whitespace-free fields are used in place; anything else is squeezed
+    // the way compile_line does it
+    auto field = [&](size_t from, size_t to, string& buf) -> string_view {
+        if (!index.any_space(from, to)) return text.substr(from, to - from);
+        buf = squeeze(text.substr(from, to - from));
+        return buf;
+    };
+
+    // The common "CPU, 50" shape: digits right up to the end of the field
+    auto plain_operand = [&](size_t from, size_t to, int32_t& value) {
+        bool negative = from < to && text[from] == '-';
+        unsigned long long v;
+        auto [stop, ec] = from_chars(text.data() + from + negative, text.data() + to, v);
+        if (ec != errc() || stop != text.data() + to || v > (unsigned long long)INT_MAX + negative) return false;
+        value = (int32_t)(negative ? -(long long)v : (long long)v);
+        return true;
+    };
+
+    const uint32_t* next = index.structurals();
+    for (; start < text.size(); line_no++) {
+        size_t c1 = *next++, end = c1;
+        if (c1 < text.size() && text[c1] == ',') {
+            end = *next++;
+            size_t c2 = end;
+            while (end < text.size() && text[end] != '\n') end = *next++;
+            string_view line = text.substr(start, end - start);
+            try {
+                // Skip the usual space after the comma without copying
+                size_t from = c1 + 1;
+                while (from < c2 && text[from] == ' ') from++;
+                int32_t value;
+                if (!plain_operand(from, c2, value)) value = parse_operand(field(from, c2, operand_buf));
+
+                // Keywords hold no whitespace, so a match on the raw text is final
+                opcode op = keyword(text.substr(start, c1 - start));
+                if (op != opcode::UNKNOWN) out.code.push_back(instruction{op, value, 0, 0});
+                else out.code.push_back(decode(line, field(start, c1, activity_buf), value, names, out.literals));
+            } catch (const runtime_error& e) {
+                throw runtime_error("line " + to_string(line_no) + ": " + e.what());
+            }
+            if (line_numbers) line_numbers->push_back(line_no);
+        } else if (end > start) {
+            out.code.push_back(unknown_line(text.substr(start, end - start), out.literals));
+            if (line_numbers) line_numbers->push_back(line_no);
+        }
+        start = end + 1;
+    }
+    return line_no - first_line;
+}
+
+compiled_trace compile_trace(const vector<string>& lines, string_pool& names) {
+    compiled_trace out;
+    out.code.reserve(lines.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (lines[i].empty()) continue;
+        try {
+            out.code.push_back(compile_line(lines[i], names, out.literals));
+        } catch (const runtime_error& e) {
+            throw runtime_error("line " + to_string(i + 1) + ": " + e.what());
+        }
+    }
+    return out;
+}
+
+compiled_trace compile_trace_file(const string& path, string_pool& names) {
+    auto reader = line_reader::open(path);
+    compiled_trace out;
+    string_view text;
+    for (size_t first = 1; reader->next_block(text); first = reader->line_number() + 1) {
+        try {
+            compile_block(text, first, names, out);
+        } catch (const runtime_error& e) {
+            throw runtime_error(path + ": " + e.what());
+        }
+    }
+    return out;
+}
+
+compiled_program compile_program(const string& path) {
+    compiled_program out;
+    out.trace = compile_trace_file(path, out.names);
+
+    const auto& code = out.trace.code;
+    uint32_t n = (uint32_t)code.size();
+    out.jump.assign(n, n);
+    uint32_t next_parent = n, next_endif = n;
+    for (uint32_t i = n; i-- > 0;) {
+        if (code[i].op == opcode::IF_CHILD) out.jump[i] = min(next_parent, next_endif);
+        else if (code[i].op == opcode::IF_PARENT) { out.jump[i] = next_endif; next_parent = i; }
+        else if (code[i].op == opcode::ENDIF) next_endif = i;
+    }
+    return out;
+}
+
+compiled_bundle compile_trace_tree(const string& path, const string& program_dir, string_pool& names) {
+    compiled_bundle bundle;
+    bundle.main = compile_trace_file(path, names);
+
+    vector<const compiled_trace*> pending = {&bundle.main};
+    while (!pending.empty()) {
+        const compiled_trace* trace = pending.back();
+        pending.pop_back();
+        for (const auto& ins : trace->code) {
+            if (ins.op != opcode::EXEC || bundle.programs.count(ins.image)) continue;
+            string file = program_dir + "/" + names.name(ins.image) + ".txt";
+            if (!ifstream(file).is_open()) continue;
+            auto [it, _] = bundle.programs.emplace(ins.image, compile_trace_file(file, names));
+            pending.push_back(&it->second);
+        }
+    }
+    return bundle;
+}
@@ -0,0 +1,104 @@
+#ifndef TRACE_COMPILER_HPP_
+#define TRACE_COMPILER_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// ====================== COMPILED TRACE FORMAT ======================
+
+enum class opcode : std::uint8_t {
+    FORK,
+    EXEC,
+    CPU,
+    SYSCALL,
+    END_IO,
+    IF_CHILD,
+    IF_PARENT,
+    ENDIF,
+    UNKNOWN
+};
+
+const char* opcode_name(opcode op);
+
+// One trace line after compilation. For EXEC, `program` is the interned
+// program name as shown in the logs ("program1") and `image` the interned
+// file stem it was loaded from ("program1_2"). For UNKNOWN, `program`
+// indexes compiled_trace::literals.
+struct instruction {
+    opcode op;
+    std::int32_t value;
+    std::uint32_t program;
+    std::uint32_t image;
+};
+
+// Interns program names so the simulator compares ids instead of strings.
+// The index is keyed by views into `names`, whose deque keeps every string
+// in place, so a lookup never allocates. Copies rebuild the index over
+// their own strings.
+class string_pool {
+public:
+    static constexpr std::uint32_t npos = UINT32_MAX;
+
+    string_pool() = default;
+    string_pool(const string_pool& other) : names(other.names) { reindex(); }
+    string_pool& operator=(const string_pool& other);
+    string_pool(string_pool&&) = default;
+    string_pool& operator=(string_pool&&) = default;
+
+    std::uint32_t intern(std::string_view name);
+    std::uint32_t find(std::string_view name) const;
+    const std::string& name(std::uint32_t id) const { return names[id]; }
+    std::size_t size() const { return names.size(); }
+
+private:
+    void reindex();
+
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, std::uint32_t> index;
+};
+
+struct compiled_trace {
+    std::vector<instruction> code;
+    std::vector<std::string> literals;   // raw text of unrecognised lines
+};
+
+// A trace plus every program file reachable from it through EXEC
+struct compiled_bundle {
+    compiled_trace main;
+    std::unordered_map<std::uint32_t, compiled_trace> programs;   // keyed by image id
+};
+
+// A trace file compiled with its own name pool so it can be shared between
+// simulations. `jump` sends IF_CHILD to the next IF_PARENT (or ENDIF) and
+// IF_PARENT to the next ENDIF, so a branch is skipped in one step.
+struct compiled_program {
+    string_pool names;
+    compiled_trace trace;
+    std::vector<std::uint32_t> jump;
+};
+
+// ===================== FUNCTION DECLARATIONS =====================
+
+// Throws std::runtime_error when the operand is not a number
+instruction compile_line(std::string_view line, string_pool& names,
+                         std::vector<std::string>& literals);
+compiled_trace compile_trace(const std::vector<std::string>& lines, string_pool& names);
+
+// Compiles a block of whole lines (line_reader::next_block) in one pass over
+// SIMD delimiter masks; the result is the same as compile_line on each
+// non-empty line. `first_line` numbers the errors, which are thrown as
+// std::runtime_error("line N: ...") after the lines before N were appended.
+// With `line_numbers`, the line of each appended instruction goes there too.
+// Returns the number of lines in the block.
+std::size_t compile_block(std::string_view text, std::size_t first_line, string_pool& names,
+                          compiled_trace& out, std::vector<std::size_t>* line_numbers = nullptr);
+compiled_trace compile_trace_file(const std::string& path, string_pool& names);
+compiled_program compile_program(const std::string& path);
+compiled_bundle compile_trace_tree(const std::string& path, const std::string& program_dir,
+                                   string_pool& names);
+
+#endif
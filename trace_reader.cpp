@@ -0,0 +1,164 @@
+#include "trace_reader.hpp"
+#include "binary_log.hpp"
+#include "text_scan.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+unique_ptr<line_reader> line_reader::open(const string& path) {
+    if (path == "-") return make_unique<chunked_line_reader>(STDIN_FILENO, false);
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw runtime_error("cannot open " + path + ": " + strerror(errno));
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        char magic[sizeof BINARY_LOG_MAGIC];
+        if (pread(fd, magic, sizeof magic, 0) == (ssize_t)sizeof magic &&
+            memcmp(magic, BINARY_LOG_MAGIC, sizeof magic) == 0) {
+            close(fd);
+            return make_unique<binary_line_reader>(path);
+        }
+        try {
+            return make_unique<mapped_line_reader>(fd, (size_t)st.st_size);
+        } catch (const runtime_error&) {
+            // fall through to the chunked reader (e.g. filesystems without mmap)
+        }
+    }
+    return make_unique<chunked_line_reader>(fd);
+}
+
+bool line_reader::next_block(string_view& text, size_t max_bytes) {
+    block.clear();
+    string_view line;
+    while (block.size() < max_bytes && next(line)) {
+        block.append(line);
+        block += '\n';
+    }
+    text = block;
+    return !block.empty();
+}
+
+// ---------------------- mapped_line_reader ----------------------
+
+mapped_line_reader::mapped_line_reader(int fd, size_t _size) : size(_size) {
+    if (size > 0) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) throw runtime_error(string("mmap failed: ") + strerror(errno));
+        madvise(p, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(p);
+    }
+    close(fd);   // the mapping keeps the file alive
+}
+
+mapped_line_reader::~mapped_line_reader() {
+    if (data) munmap(const_cast<char*>(data), size);
+}
+
+bool mapped_line_reader::next(string_view& line) {
+    if (pos >= size) return false;
+    const char* start = data + pos;
+    const void* nl = memchr(start, '\n', size - pos);
+    size_t len = nl ? (size_t)(static_cast<const char*>(nl) - start) : size - pos;
+    line = string_view(start, len);
+    pos += len + 1;
+    lines_read++;
+    release_before(start - data);
+    return true;
+}
+
+bool mapped_line_reader::next_block(string_view& text, size_t max_bytes) {
+    if (pos >= size) return false;
+    size_t start = pos, end = size;
+    if (size - pos > max_bytes) {
+        // Cut after the last newline that fits, or after the first one past
+        // the limit when a single line is longer
+        const char* p = data + pos;
+        const void* nl = memrchr(p, '\n', max_bytes);
+        if (!nl) nl = memchr(p + max_bytes, '\n', size - pos - max_bytes);
+        if (nl) end = (size_t)(static_cast<const char*>(nl) - data) + 1;
+    }
+    text = string_view(data + start, end - start);
+    pos = end;
+    lines_read += count_newlines(text) + (text.back() != '\n');
+    release_before(start);
+    return true;
+}
+
+// Drop pages we are done with so resident memory stays flat on huge traces.
+// Pages from `offset` on are kept, since the caller still points into them.
+void mapped_line_reader::release_before(size_t offset) {
+    size_t done = offset & ~(RELEASE_STEP - 1);
+    if (done >= released + RELEASE_STEP) {
+        madvise(const_cast<char*>(data) + released, done - released, MADV_DONTNEED);
+        released = done;
+    }
+}
+
+// ---------------------- chunked_line_reader ---------------------
+
+chunked_line_reader::chunked_line_reader(int _fd, bool _owns_fd) : fd(_fd), owns_fd(_owns_fd) {}
+
+chunked_line_reader::~chunked_line_reader() {
+    if (owns_fd) close(fd);
+}
+
+bool chunked_line_reader::next(string_view& line) {
+    for (;;) {
+        size_t nl = buffer.find('\n', pos);
+        if (nl != string::npos) {
+            line = string_view(buffer).substr(pos, nl - pos);
+            pos = nl + 1;
+            lines_read++;
+            return true;
+        }
+        if (eof) {
+            if (pos >= buffer.size()) return false;
+            line = string_view(buffer).substr(pos);
+            pos = buffer.size();
+            lines_read++;
+            return true;
+        }
+        refill();
+    }
+}
+
+// Everything buffered up to the last newline; chunks are already small
+bool chunked_line_reader::next_block(string_view& text, size_t) {
+    for (;;) {
+        size_t nl = buffer.rfind('\n');
+        if (nl != string::npos && nl >= pos) {
+            text = string_view(buffer).substr(pos, nl + 1 - pos);
+            pos = nl + 1;
+            lines_read += count_newlines(text);
+            return true;
+        }
+        if (eof) {
+            if (pos >= buffer.size()) return false;
+            text = string_view(buffer).substr(pos);
+            pos = buffer.size();
+            lines_read++;
+            return true;
+        }
+        refill();
+    }
+}
+
+// Keep only the unfinished line, then read another chunk
+void chunked_line_reader::refill() {
+    buffer.erase(0, pos);
+    pos = 0;
+    size_t old = buffer.size();
+    buffer.resize(old + CHUNK_SIZE);
+    ssize_t n;
+    do { n = read(fd, &buffer[old], CHUNK_SIZE); } while (n < 0 && errno == EINTR);
+    if (n < 0) throw runtime_error(string("read failed: ") + strerror(errno));
+    buffer.resize(old + (size_t)n);
+    if (n == 0) eof = true;
+}
@@ -0,0 +1,77 @@
+#ifndef TRACE_READER_HPP_
+#define TRACE_READER_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// ======================== LINE READERS ========================
+
+// Yields the lines of a file as string_views into the reader's own buffer.
+// A view stays valid until the next call to next(). Line endings are
+// stripped exactly like getline: '\n' only, a final unterminated line
+// is still returned.
+class line_reader {
+public:
+    virtual ~line_reader() = default;
+    virtual bool next(std::string_view& line) = 0;
+    std::size_t line_number() const { return lines_read; }
+
+    // The next whole lines at once, '\n'-terminated except perhaps the last
+    // line of the file, for parsers that scan many lines per call. Usually
+    // about `max_bytes`, more when a single line is longer. Valid until the
+    // next call; line_number() counts every line in the block.
+    virtual bool next_block(std::string_view& text, std::size_t max_bytes = BLOCK_SIZE);
+    static constexpr std::size_t BLOCK_SIZE = 1 << 20;
+
+    // Regular files are memory-mapped; pipes, FIFOs and "-" (stdin) are
+    // read in chunks. Binary logs (binary_log.hpp) are decoded back to their
+    // text lines. Throws std::runtime_error if the file can't be opened.
+    static std::unique_ptr<line_reader> open(const std::string& path);
+
+protected:
+    std::size_t lines_read = 0;
+
+private:
+    std::string block;   // lines copied together by the default next_block
+};
+
+// Whole file mapped read-only, walked with memchr
+class mapped_line_reader : public line_reader {
+public:
+    mapped_line_reader(int fd, std::size_t size);
+    ~mapped_line_reader() override;
+    bool next(std::string_view& line) override;
+    bool next_block(std::string_view& text, std::size_t max_bytes) override;
+
+private:
+    static constexpr std::size_t RELEASE_STEP = 1 << 24;   // page-aligned
+    void release_before(std::size_t offset);
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+    std::size_t pos = 0;
+    std::size_t released = 0;
+};
+
+// Fallback for anything that can't be mapped
+class chunked_line_reader : public line_reader {
+public:
+    explicit chunked_line_reader(int fd, bool owns_fd = true);
+    ~chunked_line_reader() override;
+    bool next(std::string_view& line) override;
+    bool next_block(std::string_view& text, std::size_t max_bytes) override;
+
+private:
+    static constexpr std::size_t CHUNK_SIZE = 1 << 16;
+    void refill();
+
+    int fd;
+    bool owns_fd;
+    bool eof = false;
+    std::string buffer;
+    std::size_t pos = 0;
+};
+
+#endif
@@ -0,0 +1,62 @@
+// Writes a seeded synthetic workload (trace, vector/device/external-file
+// tables and program files) into <out_dir>, which can be used as a
+// simulator input_files directory.
+// Usage: tracegen [--seed N] [--lines N] [--fork-rate P] [--fork-depth N]
+//                 [--exec-fanout N] [--programs N] [--program-lines N]
+//                 [--syscall-mix P] [--sizes uniform|skewed] [--max-size MB]
+//                 [--devices N] [--name TRACE] <out_dir>
+#include "workload_gen.hpp"
+#include <filesystem>
+#include <iostream>
+
+using namespace std;
+
+static int usage() {
+    cerr << "usage: tracegen [--seed N] [--lines N] [--fork-rate P] [--fork-depth N] [--exec-fanout N]\n"
+            "                [--programs N] [--program-lines N] [--syscall-mix P]\n"
+            "                [--sizes uniform|skewed] [--max-size MB] [--devices N] [--name TRACE] <out_dir>\n";
+    return 1;
+}
+
+int main(int argc, char** argv) {
+    workload_spec spec;
+    string dir;
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--seed" && has_value) spec.seed = stoull(argv[++i]);
+            else if (arg == "--lines" && has_value) spec.lines = stoull(argv[++i]);
+            else if (arg == "--fork-rate" && has_value) spec.fork_rate = stod(argv[++i]);
+            else if (arg == "--fork-depth" && has_value) spec.fork_depth = (unsigned)stoul(argv[++i]);
+            else if (arg == "--exec-fanout" && has_value) spec.exec_fanout = (unsigned)stoul(argv[++i]);
+            else if (arg == "--programs" && has_value) spec.programs = (unsigned)stoul(argv[++i]);
+            else if (arg == "--program-lines" && has_value) spec.program_lines = (unsigned)stoul(argv[++i]);
+            else if (arg == "--syscall-mix" && has_value) spec.syscall_mix = stod(argv[++i]);
+            else if (arg == "--sizes" && has_value) {
+                if (!parse_size_distribution(argv[++i], spec.sizes)) {
+                    cerr << "Unknown size distribution: " << argv[i] << " (uniform, skewed)\n";
+                    return 1;
+                }
+            } else if (arg == "--max-size" && has_value) spec.max_size = (unsigned)stoul(argv[++i]);
+            else if (arg == "--devices" && has_value) spec.devices = (unsigned)stoul(argv[++i]);
+            else if (arg == "--name" && has_value) spec.trace_name = argv[++i];
+            else if (dir.empty() && arg[0] != '-') dir = arg;
+            else return usage();
+        }
+    } catch (const exception&) {
+        return usage();
+    }
+    if (dir.empty() || spec.max_size == 0 || spec.syscall_mix < 0 || spec.syscall_mix > 0.5) return usage();
+
+    try {
+        filesystem::create_directories(dir);
+        uint64_t lines = generate_workload(spec, dir);
+        cout << "wrote " << dir << "/" << spec.trace_name << ".txt (" << lines << " lines, "
+             << spec.programs << " programs, seed " << spec.seed << ")\n";
+    } catch (const exception& e) {
+        cerr << "tracegen: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "workload_gen.hpp"
+#include "log_writer.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+bool parse_size_distribution(string_view name, size_distribution& dist) {
+    if (name == "uniform") dist = size_distribution::UNIFORM;
+    else if (name == "skewed") dist = size_distribution::SKEWED;
+    else return false;
+    return true;
+}
+
+namespace {
+
+// Programs are split into fork_depth tiers; tier t only EXECs tier t + 1
+unsigned tier_start(const workload_spec& spec, unsigned tier) {
+    return (unsigned)((uint64_t)tier * spec.programs / max(spec.fork_depth, 1u));
+}
+
+unsigned tier_of(const workload_spec& spec, unsigned program) {
+    unsigned tier = 0;
+    while (tier + 1 < spec.fork_depth && tier_start(spec, tier + 1) <= program) tier++;
+    return tier;
+}
+
+// Writes trace lines and counts them
+class trace_writer {
+public:
+    trace_writer(const string& path, const workload_spec& spec, mt19937_64& rng)
+        : out(log_sink::to_file(path)), spec(spec), rng(rng) {}
+
+    void line(string_view op, long long val) {
+        out.write(op); out.write(", "); out.write_int(val); out.write('\n');
+        written++;
+    }
+
+    // CPU burst, SYSCALL or END_IO in the configured mix
+    void plain() {
+        double r = unit(rng);
+        if (r < spec.syscall_mix) line("SYSCALL", device());
+        else if (r < 2 * spec.syscall_mix) line("END_IO", device());
+        else line("CPU", uniform_int_distribution<int>(1, 200)(rng));
+    }
+
+    // FORK block whose child branch EXECs a program from `tier`; the
+    // parent branch runs a few plain lines
+    void fork_block(unsigned tier) {
+        line("FORK", uniform_int_distribution<int>(5, 20)(rng));
+        line("IF_CHILD", 0);
+        unsigned program = uniform_int_distribution<unsigned>(tier_start(spec, tier),
+                                                              tier_start(spec, tier + 1) - 1)(rng);
+        out.write("EXEC program"); out.write_int(program); out.write(", ");
+        out.write_int(uniform_int_distribution<int>(10, 60)(rng)); out.write('\n');
+        written++;
+        line("IF_PARENT", 0);
+        for (int n = uniform_int_distribution<int>(0, 2)(rng); n > 0; n--) plain();
+        line("ENDIF", 0);
+    }
+
+    void finish() { out.flush(); }
+
+    uint64_t written = 0;
+
+private:
+    int device() { return uniform_int_distribution<int>(0, (int)spec.devices - 1)(rng); }
+
+    log_sink out;
+    const workload_spec& spec;
+    mt19937_64& rng;
+    uniform_real_distribution<double> unit{0.0, 1.0};
+};
+
+unsigned program_size(const workload_spec& spec, mt19937_64& rng) {
+    if (spec.sizes == size_distribution::UNIFORM)
+        return uniform_int_distribution<unsigned>(1, spec.max_size)(rng);
+    // Geometric: about half the programs are within max_size / 8
+    double mean = max(1.0, spec.max_size / 8.0);
+    unsigned size = 1 + geometric_distribution<unsigned>(1.0 / mean)(rng);
+    return min(size, spec.max_size);
+}
+
+}   // namespace
+
+uint64_t generate_workload(const workload_spec& spec, const string& dir) {
+    if (spec.devices == 0) throw runtime_error("need at least one device");
+    if (spec.programs < spec.fork_depth) throw runtime_error("need at least one program per fork level");
+    mt19937_64 rng(spec.seed);
+
+    // Vector table: one ISR address per device (the simulator indexes it by device)
+    {
+        log_sink out = log_sink::to_file(dir + "/vector_table.txt");
+        unsigned vectors = max(spec.devices, 26u);
+        char buf[16];
+        for (unsigned i = 0; i < vectors; i++) {
+            snprintf(buf, sizeof buf, "0X%04X", (unsigned)(rng() & 0x0FFF));
+            out.write(buf); out.write('\n');
+        }
+    }
+    {
+        log_sink out = log_sink::to_file(dir + "/device_table.txt");
+        for (unsigned i = 0; i < spec.devices; i++) {
+            out.write_int(uniform_int_distribution<int>(50, 500)(rng)); out.write('\n');
+        }
+    }
+    {
+        log_sink out = log_sink::to_file(dir + "/external_files.txt");
+        for (unsigned i = 0; i < spec.programs; i++) {
+            out.write("program"); out.write_int(i); out.write(',');
+            out.write_int(program_size(spec, rng)); out.write('\n');
+        }
+    }
+
+    for (unsigned i = 0; i < spec.programs; i++) {
+        trace_writer program(dir + "/program" + to_string(i) + ".txt", spec, rng);
+        unsigned next_tier = tier_of(spec, i) + 1;
+        vector<unsigned> forks_at;
+        for (unsigned f = 0; f < spec.exec_fanout && next_tier < spec.fork_depth; f++)
+            forks_at.push_back(uniform_int_distribution<unsigned>(0, spec.program_lines)(rng));
+        sort(forks_at.begin(), forks_at.end());
+        size_t next = 0;
+        for (unsigned n = 0; n <= spec.program_lines; n++) {
+            for (; next < forks_at.size() && forks_at[next] == n; next++) program.fork_block(next_tier);
+            if (n < spec.program_lines) program.plain();
+        }
+        program.finish();
+    }
+
+    trace_writer trace(dir + "/" + spec.trace_name + ".txt", spec, rng);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    while (trace.written < spec.lines) {
+        if (spec.fork_depth > 0 && unit(rng) < spec.fork_rate) trace.fork_block(0);
+        else trace.plain();
+    }
+    trace.finish();
+    return trace.written;
+}
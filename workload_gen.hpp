@@ -0,0 +1,42 @@
+#ifndef WORKLOAD_GEN_HPP_
+#define WORKLOAD_GEN_HPP_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// ======================== WORKLOAD GENERATOR ========================
+
+enum class size_distribution : std::uint8_t {
+    UNIFORM,   // 1..max_size
+    SKEWED     // mostly small programs with a long tail, like the assignment's tables
+};
+
+bool parse_size_distribution(std::string_view name, size_distribution& dist);   // "uniform|skewed"
+
+struct workload_spec {
+    std::uint64_t seed = 1;
+    std::uint64_t lines = 1000;         // main trace length (fork blocks included)
+    double fork_rate = 0.01;            // chance per main-trace line of starting a fork block
+    unsigned fork_depth = 2;            // levels of FORK + EXEC below the main trace
+    unsigned exec_fanout = 2;           // FORK + EXEC blocks per program file
+    unsigned programs = 8;              // program files (program0.txt ...)
+    unsigned program_lines = 8;         // plain lines per program file
+    double syscall_mix = 0.2;           // share of SYSCALL lines; END_IO gets the same share
+    size_distribution sizes = size_distribution::SKEWED;
+    unsigned max_size = 40;             // MB
+    unsigned devices = 20;
+    std::string trace_name = "trace_1";
+};
+
+// Writes <dir>/<trace_name>.txt plus the vector_table.txt, device_table.txt,
+// external_files.txt and program files it refers to. The same spec always
+// produces the same files. Fork blocks are never nested inside one
+// another; depth comes from the child branch EXECing a program that forks
+// in turn. Programs are split into fork_depth tiers and tier t only EXECs
+// tier t + 1, so EXEC chains always end and at most fork_depth + 1
+// processes of one chain are alive at once. Returns the number of main-trace lines written. Throws
+// std::runtime_error on I/O errors.
+std::uint64_t generate_workload(const workload_spec& spec, const std::string& dir);
+
+#endif